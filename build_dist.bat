@@ -50,7 +50,7 @@ copy "README.md" "dist_final\"
 
 :: 复制静态资源文件夹
 echo [Build] Copying static assets...
-xcopy "resources\static" "dist_final\eams\static\" /E /I /Y
+xcopy "build\bin\eams\static" "dist_final\eams\static\" /E /I /Y
 
 echo.
 echo ======================================================
@@ -10,6 +10,8 @@
 #define UNICODE
 #endif
 
+#include "NeuCourseApi.h"
+
 #include <cstdio>
 #include <iostream>
 #include <string>
@@ -23,6 +25,9 @@
 #define ID_BTN_SERVER 104
 #define ID_BTN_COPY_URL 105
 
+// 后台生成结束后发给主窗口的消息，lParam 为 GenerateTask*
+#define WM_APP_GENERATED (WM_APP + 1)
+
 LRESULT CALLBACK WindowProc (HWND hwnd, UINT uMsg, WPARAM wParam,
                              LPARAM lParam);
 
@@ -31,6 +36,7 @@ HWND hStatus;
 HWND hDateInput;
 HWND hBtnServer;
 HWND hBtnCopy;
+HWND hBtnGenerate;
 HANDLE hServerProcess = NULL;
 std::wstring currentUrl = L"";
 
@@ -101,6 +107,26 @@ GetLocalIP ()
   return ip;
 }
 
+// 一次后台生成：直接调用解析库，不再启动 NeuCourseTabel.exe 并等待它结束
+struct GenerateTask
+{
+  HWND hwnd;
+  char date[32]; // UTF-8 的开学日期
+  int rc;
+  size_t courses;
+  char err[512];
+};
+
+DWORD WINAPI
+GenerateThread (LPVOID param)
+{
+  GenerateTask *task = (GenerateTask *)param;
+  task->rc = nct_convert_file ("exp.html", ".", task->date, 0, &task->courses,
+                               task->err, sizeof (task->err));
+  PostMessage (task->hwnd, WM_APP_GENERATED, 0, (LPARAM)task);
+  return 0;
+}
+
 // 复制到剪贴板
 void
 CopyToClipboard (HWND hwnd, const std::wstring &text)
@@ -183,9 +209,10 @@ WindowProc (HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             L"EDIT", L"2026-03-01", WS_VISIBLE | WS_CHILD | WS_BORDER, 20, 140,
             150, 25, hwnd, (HMENU)ID_EDIT_DATE, NULL, NULL); // 编辑框输入
 
-        CreateWindow (L"BUTTON", L"生成日历文件 (.ics)",
-                      WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON, 20, 180, 150, 40,
-                      hwnd, (HMENU)ID_BTN_GENERATE, NULL, NULL); // 生成按钮
+        hBtnGenerate = CreateWindow (
+            L"BUTTON", L"生成日历文件 (.ics)",
+            WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON, 20, 180, 150, 40, hwnd,
+            (HMENU)ID_BTN_GENERATE, NULL, NULL); // 生成按钮
 
         // 第三步：服务器
         CreateWindow (L"STATIC", L"第三步 (可选)：开启手机访问 (Port 8080)",
@@ -264,35 +291,19 @@ WindowProc (HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             GetWindowText (hDateInput, date, 20); // 获取输入框中的日期字符串
 
             SetWindowText (hStatus, L"正在解析并生成日历...");
-
-            wchar_t path[MAX_PATH];
-            GetModuleFileName (NULL, path, MAX_PATH);
-            std::wstring fullPath (path);
-            size_t pos_path = fullPath.find_last_of (L"\\/");
-            std::wstring dir = fullPath.substr (0, pos_path + 1);
-
-            std::wstring cmd = L"\"" + dir + L"NeuCourseTabel.exe\" "
-                               + date; // 拼接后端命令
-
-            STARTUPINFO si = { sizeof (si) }; // 启动信息
-            PROCESS_INFORMATION pi;           // 进程信息
-            if (CreateProcess (NULL, (LPWSTR)cmd.c_str (), NULL, NULL, FALSE,
-                               CREATE_NO_WINDOW, NULL, NULL, &si,
-                               &pi)) // 后台运行解析进程
-              {
-                WaitForSingleObject (pi.hProcess, INFINITE); // 等待进程结束
-                CloseHandle (pi.hProcess);                   // 关闭进程句柄
-                CloseHandle (pi.hThread);                    // 关闭线程句柄
-                SetWindowText (hStatus, L"成功！生成了 schedule.ics");
-                MessageBox (
-                    hwnd,
-                    L"日历文件生成成功！\n旧版 HTML 预览也在同目录下生成了。",
-                    L"完成", MB_OK | MB_ICONINFORMATION); // 提示完成
-              }
+            EnableWindow (hBtnGenerate, FALSE); // 完成前不能重复点击
+
+            // 在后台线程中解析，窗口在此期间仍能响应
+            GenerateTask *task = new GenerateTask ();
+            task->hwnd = hwnd;
+            WideCharToMultiByte (CP_UTF8, 0, date, -1, task->date,
+                                 sizeof (task->date), NULL, NULL);
+            HANDLE thread
+                = CreateThread (NULL, 0, GenerateThread, task, 0, NULL);
+            if (thread)
+              CloseHandle (thread);
             else
-              {
-                SetWindowText (hStatus, L"错误：无法运行 NeuCourseTabel.exe");
-              }
+              GenerateThread (task); // 无法创建线程时就地生成
           }
         else if (LOWORD (wParam) == ID_BTN_SERVER) // 开启服务器
           {
@@ -387,6 +398,31 @@ WindowProc (HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
           }
         break;
       }
+    case WM_APP_GENERATED: // 后台生成结束
+      {
+        GenerateTask *task = (GenerateTask *)lParam;
+        EnableWindow (hBtnGenerate, TRUE);
+        if (task->rc == NCT_OK)
+          {
+            std::wstring msg = L"成功！提取 "
+                               + std::to_wstring (task->courses)
+                               + L" 门课程，生成了 schedule.ics";
+            SetWindowText (hStatus, msg.c_str ());
+            MessageBox (hwnd,
+                        L"日历文件生成成功！\n"
+                        L"旧版 HTML 预览也在同目录下生成了。",
+                        L"完成", MB_OK | MB_ICONINFORMATION); // 提示完成
+          }
+        else
+          {
+            wchar_t werr[512];
+            MultiByteToWideChar (CP_UTF8, 0, task->err, -1, werr, 512);
+            std::wstring msg = std::wstring (L"解析失败：") + werr;
+            SetWindowText (hStatus, msg.c_str ());
+          }
+        delete task;
+        return 0;
+      }
     case WM_DESTROY: // 窗口销毁
       if (hServerProcess != NULL)
         {
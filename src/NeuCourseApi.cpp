@@ -0,0 +1,228 @@
+/**
+ * @file NeuCourseApi.cpp
+ * @author PopulusYang
+ * @brief 课表解析库 C 接口的实现，只是 NeuCourseCore 的一层薄包装
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+#include "NeuCourseApi.h"
+#include "NeuCourseCore.h"
+
+#include <cstring>
+#include <exception>
+#include <new>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+struct nct_schedule
+{
+  Schedule sched;
+
+  // 最近一次生成的输出。缓冲区不够时调用者会以相同参数再调用一次，
+  // 这时直接复制而不重新生成
+  string outputKey;
+  string output;
+};
+
+// 把 sched->output 复制到调用者的缓冲区
+int
+copyOutput (const nct_schedule *sched, char *buf, size_t cap, size_t *len)
+{
+  if (len)
+    *len = sched->output.size ();
+  if (cap < sched->output.size () || (!buf && !sched->output.empty ()))
+    return NCT_E_BUFFER;
+  if (!sched->output.empty ())
+    memcpy (buf, sched->output.data (), sched->output.size ());
+  return NCT_OK;
+}
+
+// 生成一种输出并复制到 buf；key 与上次相同时沿用上次的结果
+template <typename Render>
+int
+emit (nct_schedule *sched, const string &key, char *buf, size_t cap,
+      size_t *len, Render render)
+{
+  if (!sched)
+    return NCT_E_INVALID;
+  try
+    {
+      if (sched->outputKey != key)
+        {
+          sched->outputKey.clear ();
+          render (sched->output);
+          sched->outputKey = key;
+        }
+      return copyOutput (sched, buf, cap, len);
+    }
+  catch (...)
+    {
+      sched->outputKey.clear ();
+      return NCT_E_INTERNAL;
+    }
+}
+
+void
+setError (char *err, size_t cap, const string &msg)
+{
+  if (!err || cap == 0)
+    return;
+  size_t n = msg.size () < cap - 1 ? msg.size () : cap - 1;
+  while (n > 0 && n < msg.size () && (msg[n] & 0xC0) == 0x80)
+    --n; // 不截断在 UTF-8 字符中间
+  memcpy (err, msg.data (), n);
+  err[n] = '\0';
+}
+
+extern "C"
+{
+
+  const char *
+  nct_version (void)
+  {
+    return "1.0";
+  }
+
+  nct_schedule *
+  nct_parse (const char *html, size_t size)
+  {
+    if (!html && size)
+      return NULL;
+    try
+      {
+        nct_schedule *sched = new nct_schedule;
+        sched->sched = parseSchedule (html ? html : "", size);
+        return sched;
+      }
+    catch (...)
+      {
+        return NULL;
+      }
+  }
+
+  void
+  nct_free (nct_schedule *sched)
+  {
+    delete sched;
+  }
+
+  size_t
+  nct_course_count (const nct_schedule *sched)
+  {
+    return sched ? sched->sched.courses.size () : 0;
+  }
+
+  int
+  nct_get_course (const nct_schedule *sched, size_t index, nct_course *out)
+  {
+    if (!sched || !out || index >= sched->sched.courses.size ())
+      return NCT_E_INVALID;
+    const Course &c = sched->sched.courses[index];
+    out->title = c.title.c_str ();
+    out->location = c.location.c_str ();
+    out->description = c.description.c_str ();
+    out->weeks = c.weekStr.c_str ();
+    out->day = c.day;
+    out->start_period = c.startPeriod;
+    out->end_period = c.endPeriod;
+    out->week_mask = c.weeks;
+    return NCT_OK;
+  }
+
+  const char *
+  nct_semester_info (const nct_schedule *sched)
+  {
+    return sched ? sched->sched.semesterInfo.c_str () : NULL;
+  }
+
+  int
+  nct_write_ics (nct_schedule *sched, const char *start_sunday,
+                 unsigned flags, char *buf, size_t cap, size_t *len)
+  {
+    if (!start_sunday || !SemesterCalendar (start_sunday).valid ())
+      return NCT_E_INVALID;
+    bool expanded = (flags & NCT_EXPAND_ICS) != 0;
+    string key = string ("ics\x1f") + start_sunday;
+    if (expanded)
+      key += "\x1f" "expand";
+    return emit (sched, key, buf, cap, len, [&] (string &out) {
+      ostringstream ics;
+      writeIcs (ics, sched->sched.courses, start_sunday, expanded);
+      out = ics.str ();
+    });
+  }
+
+  int
+  nct_write_csv (nct_schedule *sched, char *buf, size_t cap, size_t *len)
+  {
+    return emit (sched, "csv", buf, cap, len, [&] (string &out) {
+      ostringstream csv;
+      writeCsv (csv, sched->sched.courses);
+      out = csv.str ();
+    });
+  }
+
+  int
+  nct_write_html (nct_schedule *sched, char *buf, size_t cap, size_t *len)
+  {
+    return emit (sched, "html", buf, cap, len, [&] (string &out) {
+      out = renderOldHtml (sched->sched.courses, sched->sched.semesterInfo);
+    });
+  }
+
+  int
+  nct_convert_file (const char *input, const char *dir,
+                    const char *start_sunday, unsigned flags, size_t *courses,
+                    char *err, size_t err_cap)
+  {
+    if (!input || !dir || !start_sunday
+        || !SemesterCalendar (start_sunday).valid ())
+      {
+        setError (err, err_cap, "参数无效");
+        return NCT_E_INVALID;
+      }
+    try
+      {
+        OutputOptions opts;
+        opts.expandedIcs = (flags & NCT_EXPAND_ICS) != 0;
+        opts.deltaIcs = (flags & NCT_DELTA_ICS) != 0;
+        opts.useCache = (flags & NCT_NO_CACHE) == 0;
+
+        string cachePath = joinPath (dir, "schedule.cache");
+        ScheduleCache cache;
+        bool hit, dirty;
+        size_t bytes;
+        string msg;
+        if (!loadSchedule (input, cachePath, opts.useCache, cache, hit, dirty,
+                           bytes, msg))
+          {
+            setError (err, err_cap, msg);
+            return NCT_E_IO;
+          }
+        if (courses)
+          *courses = cache.sched.courses.size ();
+
+        OutputSummary summary;
+        if (!writeOutputs (dir, cache.sched, start_sunday, cache.inputMtime,
+                           opts, summary, msg))
+          {
+            setError (err, err_cap, msg);
+            return NCT_E_IO;
+          }
+        // writeOutputs 才会创建 dir，缓存要在它之后写
+        if (dirty)
+          writeScheduleCache (cachePath, cache);
+        setError (err, err_cap, "");
+        return NCT_OK;
+      }
+    catch (const exception &e)
+      {
+        setError (err, err_cap, e.what ());
+        return NCT_E_INTERNAL;
+      }
+  }
+
+} // extern "C"
@@ -0,0 +1,97 @@
+/**
+ * @file NeuCourseApi.h
+ * @author PopulusYang
+ * @brief 课表解析库的 C 接口，供图形界面在进程内调用，也可由 Python 通过
+ *        ctypes 加载 libneucourse
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+#ifndef NEUCOURSEAPI_H
+#define NEUCOURSEAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(NCT_BUILD_DLL) && defined(_WIN32)
+#define NCT_API __declspec (dllexport)
+#elif defined(NCT_BUILD_DLL) && defined(__GNUC__)
+#define NCT_API __attribute__ ((visibility ("default")))
+#else
+#define NCT_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+  /* 解析得到的课表，由 nct_parse 创建、nct_free 释放 */
+  typedef struct nct_schedule nct_schedule;
+
+  /* 返回值 */
+  enum
+  {
+    NCT_OK = 0,
+    NCT_E_INVALID = -1, /* 参数为空、下标越界或日期无法解析 */
+    NCT_E_BUFFER = -2,  /* 缓冲区不够，*len 为所需字节数 */
+    NCT_E_IO = -3,      /* 读写文件失败 */
+    NCT_E_INTERNAL = -4 /* 内存不足等内部错误 */
+  };
+
+  /* nct_write_ics 与 nct_convert_file 的 flags */
+  enum
+  {
+    NCT_EXPAND_ICS = 1, /* 每周写一个独立事件，不使用 RRULE */
+    NCT_DELTA_ICS = 2,  /* 另写 schedule-delta.ics，仅 nct_convert_file */
+    NCT_NO_CACHE = 4    /* 不读写 schedule.cache，仅 nct_convert_file */
+  };
+
+  /* 一门课程。字符串属于课表句柄，nct_free 之前一直有效 */
+  typedef struct nct_course
+  {
+    const char *title;
+    const char *location;
+    const char *description;
+    const char *weeks; /* 原始周数文字，如 "1-16周" */
+    int day;           /* 0 为周日 */
+    int start_period;
+    int end_period;
+    uint64_t week_mask; /* 第 w 周对应第 (w - 1) 位 */
+  } nct_course;
+
+  NCT_API const char *nct_version (void);
+
+  /* 从内存中的课表页面解析课程，失败时返回 NULL */
+  NCT_API nct_schedule *nct_parse (const char *html, size_t size);
+  NCT_API void nct_free (nct_schedule *sched);
+
+  NCT_API size_t nct_course_count (const nct_schedule *sched);
+  NCT_API int nct_get_course (const nct_schedule *sched, size_t index,
+                              nct_course *out);
+  NCT_API const char *nct_semester_info (const nct_schedule *sched);
+
+  /* 把输出写进调用者的缓冲区，不含结尾的 '\0'。*len 总是设为输出的
+     字节数；cap 不够时返回 NCT_E_BUFFER 且不写 buf，可按 *len 分配后
+     以相同参数再调用一次，第二次不会重新生成 */
+  NCT_API int nct_write_ics (nct_schedule *sched, const char *start_sunday,
+                             unsigned flags, char *buf, size_t cap,
+                             size_t *len);
+  NCT_API int nct_write_csv (nct_schedule *sched, char *buf, size_t cap,
+                             size_t *len);
+  NCT_API int nct_write_html (nct_schedule *sched, char *buf, size_t cap,
+                              size_t *len);
+
+  /* 与命令行程序的单文件模式相同：解析 input（命中 dir 下的
+     schedule.cache 时不再解析），把 schedule.ics、courses.csv、
+     exp_old.html 和 eams/ 下的页面写到 dir。courses 可为 NULL；出错时
+     错误信息写进 err（可为 NULL） */
+  NCT_API int nct_convert_file (const char *input, const char *dir,
+                                const char *start_sunday, unsigned flags,
+                                size_t *courses, char *err, size_t err_cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NEUCOURSEAPI_H */
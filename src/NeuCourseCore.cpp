@@ -0,0 +1,3651 @@
+/**
+ * @file NeuCourseCore.cpp
+ * @author PopulusYang
+ * @brief 课表解析与 ICS/CSV/HTML 生成的公共部分
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+#include "NeuCourseCore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <direct.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// x86 上另外编译 SSE2 与 AVX2 版本的标记扫描，运行时按 CPU 选择
+#if ((defined(__GNUC__) || defined(__clang__))                              \
+     && (defined(__x86_64__) || defined(__i386__)))                          \
+    || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+#define NCT_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define NCT_TARGET(isa)
+#else
+#define NCT_TARGET(isa) __attribute__ ((target (isa)))
+#endif
+#endif
+
+using namespace std;
+
+// 以下文字处理函数都直接读 [begin, end) 或 (p, n) 区间，结果追加到调用
+// 者给出的 out 之后，out 可以是逐次复用的缓冲区，热路径上不产生临时字符串
+
+// 去除 [begin, end) 的首尾空白，只移动两端
+void
+trim (const char *&begin, const char *&end)
+{
+  static const char WS[] = " \n\r\t";
+  while (begin < end && memchr (WS, *begin, sizeof (WS) - 1))
+    ++begin;
+  while (end > begin && memchr (WS, end[-1], sizeof (WS) - 1))
+    --end;
+}
+
+// 去除首尾空白并把连续空白压缩为一个空格后追加到 out
+void
+clean (const char *begin, const char *end, string &out)
+{
+  trim (begin, end);
+  const char *run = begin; // 尚未追加的非空白段的起点
+  for (const char *p = begin; p < end; ++p)
+    if (isspace (*p))
+      {
+        out.append (run, p - run);
+        out += ' ';
+        while (p + 1 < end && isspace (p[1]))
+          ++p;
+        run = p + 1;
+      }
+  out.append (run, end - run);
+}
+
+// 辅助函数：转义 CSV 中的特殊字符，连同两侧的引号追加到 out
+void
+csvQuote (const char *p, size_t n, string &out)
+{
+  out += '"';
+  for (const char *end = p + n; p < end;)
+    {
+      const char *q = (const char *)memchr (p, '"', end - p);
+      if (!q)
+        {
+          out.append (p, end - p);
+          break;
+        }
+      out.append (p, q + 1 - p);
+      out += '"';
+      p = q + 1;
+    }
+  out += '"';
+}
+
+// 辅助函数：转义 HTML 属性中的双引号等特殊字符后追加到 out
+void
+escapeHtml (const char *p, size_t n, string &out)
+{
+  const char *run = p;
+  for (const char *end = p + n; p < end; ++p)
+    {
+      const char *rep;
+      switch (*p)
+        {
+        case '\"':
+          rep = "&quot;";
+          break;
+        case '\'':
+          rep = "&#39;";
+          break;
+        case '<':
+          rep = "&lt;";
+          break;
+        case '>':
+          rep = "&gt;";
+          break;
+        case '&':
+          rep = "&amp;";
+          break;
+        default:
+          continue;
+        }
+      out.append (run, p - run);
+      out += rep;
+      run = p + 1;
+    }
+  out.append (run, p - run);
+}
+
+string
+escapeHtml (const string &s)
+{
+  string res;
+  escapeHtml (s.data (), s.size (), res);
+  return res;
+}
+
+// ---- 字符串驻留 ----
+
+ostream &
+operator<< (ostream &out, const Text &t)
+{
+  return out.write (t.data (), t.size ());
+}
+
+StringPool::StringPool ()
+    : next_ (NULL), left_ (0), blockSize_ (1024), count_ (0)
+{
+}
+
+// 从当前块中取 n 字节，不够时另分配一块。块从 1 KB 起逐次加倍到 64 KB，
+// 一份课表通常只需一两块
+char *
+StringPool::allocate (size_t n)
+{
+  if (n > left_)
+    {
+      size_t size = max (blockSize_, n);
+      blocks_.push_back (unique_ptr<char[]> (new char[size]));
+      next_ = blocks_.back ().get ();
+      left_ = size;
+      if (blockSize_ < 65536)
+        blockSize_ *= 2;
+    }
+  char *p = next_;
+  next_ += n;
+  left_ -= n;
+  return p;
+}
+
+// 散列表扩大一倍并重新放入已有的字符串
+void
+StringPool::rehash ()
+{
+  vector<Text> old (slots_.empty () ? 64 : slots_.size () * 2,
+                    Text (NULL, 0));
+  old.swap (slots_);
+  size_t mask = slots_.size () - 1;
+  for (size_t i = 0; i < old.size (); ++i)
+    if (old[i].data_)
+      {
+        size_t j = hashBytes (old[i].data_, old[i].size_) & mask;
+        while (slots_[j].data_)
+          j = (j + 1) & mask;
+        slots_[j] = old[i];
+      }
+}
+
+Text
+StringPool::intern (const char *p, size_t n)
+{
+  if (n == 0)
+    return Text ();
+  if ((count_ + 1) * 2 > slots_.size ()) // 装填率不超过一半
+    rehash ();
+  size_t mask = slots_.size () - 1;
+  size_t i = hashBytes (p, n) & mask;
+  for (; slots_[i].data_; i = (i + 1) & mask)
+    if (slots_[i].size_ == n && memcmp (slots_[i].data_, p, n) == 0)
+      return slots_[i];
+  char *copy = allocate (n + 1);
+  memcpy (copy, p, n);
+  copy[n] = '\0';
+  slots_[i] = Text (copy, n);
+  ++count_;
+  return slots_[i];
+}
+
+// 把课程的各字段改为驻留到 strings 中，之后不再引用原来的池
+void
+internCourse (StringPool &strings, Course &c)
+{
+  c.title = strings.intern (c.title.data (), c.title.size ());
+  c.location = strings.intern (c.location.data (), c.location.size ());
+  c.description
+      = strings.intern (c.description.data (), c.description.size ());
+  c.weekStr = strings.intern (c.weekStr.data (), c.weekStr.size ());
+}
+
+// ---- 运行统计 ----
+
+const char *
+stageName (Stage stage)
+{
+  static const char *const NAMES[STAGE_COUNT] = {
+    "load",      "split_columns", "slots",      "extract",     "weeks",
+    "write_ics", "write_csv",     "write_html", "write_cache",
+  };
+  return NAMES[stage];
+}
+
+RunStats::RunStats ()
+    : files (0), cacheHits (0), emptyFiles (0), days (0), slots (0),
+      titles (0), filteredTitles (0), courses (0), events (0)
+{
+  memset (stages, 0, sizeof stages);
+}
+
+void
+RunStats::merge (const RunStats &other)
+{
+  for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+      stages[i].ns += other.stages[i].ns;
+      stages[i].bytes += other.stages[i].bytes;
+      stages[i].calls += other.stages[i].calls;
+    }
+  files += other.files;
+  cacheHits += other.cacheHits;
+  emptyFiles += other.emptyFiles;
+  days += other.days;
+  slots += other.slots;
+  titles += other.titles;
+  filteredTitles += other.filteredTitles;
+  courses += other.courses;
+  events += other.events;
+}
+
+// 以 JSON 输出。各步骤的耗时是所有线程的累计值，多线程时总和可以超过
+// wall_ms
+void
+RunStats::writeJson (ostream &out, double wallSeconds, unsigned threads) const
+{
+  char buf[256];
+  snprintf (buf, sizeof buf,
+            "{\n  \"files\": %llu,\n  \"cache_hits\": %llu,\n"
+            "  \"threads\": %u,\n  \"scanner\": \"%s\",\n"
+            "  \"wall_ms\": %.3f,\n",
+            files, cacheHits, threads, markerScanner (),
+            wallSeconds * 1e3);
+  out << buf;
+  snprintf (buf, sizeof buf,
+            "  \"counters\": {\"days\": %llu, \"slots\": %llu, "
+            "\"titles\": %llu, \"filtered_titles\": %llu, "
+            "\"courses\": %llu, \"events\": %llu, \"empty_files\": %llu},\n",
+            days, slots, titles, filteredTitles, courses, events, emptyFiles);
+  out << buf << "  \"stages\": {";
+  for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+      const StageStats &s = stages[i];
+      double ms = s.ns / 1e6;
+      snprintf (buf, sizeof buf,
+                "%s\n    \"%s\": {\"ms\": %.3f, \"bytes\": %llu, "
+                "\"calls\": %llu, \"mb_per_s\": %.1f}",
+                i ? "," : "", stageName ((Stage)i), ms, s.bytes, s.calls,
+                s.ns ? s.bytes / (s.ns / 1e9) / (1024.0 * 1024.0) : 0.0);
+      out << buf;
+    }
+  out << "\n  }\n}" << endl;
+}
+
+unsigned long long
+monotonicNs ()
+{
+  return chrono::duration_cast<chrono::nanoseconds> (
+             chrono::steady_clock::now ().time_since_epoch ())
+      .count ();
+}
+
+// ---- 标记扫描 ----
+// 页面中解析器要找的标记只有几种，且前两个字节互不相同。向量化的实现
+// 每次比较 16 或 32 个相邻字节对，命中某个标记前两个字节的位置再逐个
+// 确认完整的标记，一趟扫描就得到全部标记的偏移
+
+struct MarkerPattern
+{
+  const char *text;
+  size_t len;
+};
+
+#define MARKER(s) { s, sizeof (s) - 1 }
+const MarkerPattern MARKERS[MARK_KINDS]
+    = { MARKER ("<div"),
+        MARKER ("</div"),
+        MARKER ("flex:"),
+        MARKER ("class=\"title"),
+        MARKER ("class=\"kbappTimetableCourseRenderCourseItemInfoText"),
+        MARKER ("kbappTimetableDayColumnRoot"),
+        MARKER ("selected=\"\">") };
+#undef MARKER
+
+// (a, b) 是否为某个标记的前两个字节
+inline bool
+isMarkerStart (char a, char b)
+{
+  switch (a)
+    {
+    case '<':
+      return b == 'd' || b == '/';
+    case 'f':
+    case 'c':
+      return b == 'l';
+    case 'k':
+      return b == 'b';
+    case 's':
+      return b == 'e';
+    default:
+      return false;
+    }
+}
+
+// 比较 p 与 pat 的前 n 个字节（n >= 4）。不超过 16 字节时用两次可能
+// 重叠的定长读入，n 为常量时不必调用 memcmp
+inline bool
+sameBytes (const char *p, const char *pat, size_t n)
+{
+  if (n <= 8)
+    {
+      uint32_t a, b, c, d;
+      memcpy (&a, p, 4);
+      memcpy (&b, pat, 4);
+      memcpy (&c, p + n - 4, 4);
+      memcpy (&d, pat + n - 4, 4);
+      return a == b && c == d;
+    }
+  if (n <= 16)
+    {
+      uint64_t a, b, c, d;
+      memcpy (&a, p, 8);
+      memcpy (&b, pat, 8);
+      memcpy (&c, p + n - 8, 8);
+      memcpy (&d, pat + n - 8, 8);
+      return a == b && c == d;
+    }
+  return memcmp (p, pat, n) == 0;
+}
+
+// pos 处是完整的 kind 标记时记录
+template <int kind>
+inline void
+tryMarker (const char *data, size_t pos, size_t to, MarkerIndex &index)
+{
+  const MarkerPattern &m = MARKERS[kind];
+  if (to - pos >= m.len && sameBytes (data + pos, m.text, m.len))
+    index.at[kind].push_back (pos);
+}
+
+// pos 处前两个字节已经命中，确认完整的标记后记录。pos + 1 < to
+inline void
+recordMarker (const char *data, size_t pos, size_t to, MarkerIndex &index)
+{
+  switch (data[pos])
+    {
+    case '<':
+      if (data[pos + 1] == 'd')
+        tryMarker<MARK_DIV_OPEN> (data, pos, to, index);
+      else
+        tryMarker<MARK_DIV_CLOSE> (data, pos, to, index);
+      break;
+    case 'f':
+      tryMarker<MARK_FLEX> (data, pos, to, index);
+      break;
+    case 'c':
+      // 两种 class=" 标记从第 8 个字节起才不同
+      if (to - pos > 7 && data[pos + 7] == 't')
+        tryMarker<MARK_TITLE> (data, pos, to, index);
+      else
+        tryMarker<MARK_INFO> (data, pos, to, index);
+      break;
+    case 'k':
+      tryMarker<MARK_COLUMN> (data, pos, to, index);
+      break;
+    default:
+      tryMarker<MARK_SELECTED> (data, pos, to, index);
+      break;
+    }
+}
+
+void
+scanMarkersScalar (const char *data, size_t from, size_t to,
+                   MarkerIndex &index)
+{
+  for (size_t i = from; i + 1 < to; ++i)
+    if (isMarkerStart (data[i], data[i + 1]))
+      recordMarker (data, i, to, index);
+}
+
+#ifdef NCT_SIMD_X86
+
+inline int
+lowestBit (unsigned bits)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward (&idx, bits);
+  return (int)idx;
+#else
+  return __builtin_ctz (bits);
+#endif
+}
+
+NCT_TARGET ("sse2")
+void
+scanMarkersSse2 (const char *data, size_t from, size_t to, MarkerIndex &index)
+{
+  const __m128i lt = _mm_set1_epi8 ('<'), d = _mm_set1_epi8 ('d');
+  const __m128i slash = _mm_set1_epi8 ('/'), l = _mm_set1_epi8 ('l');
+  const __m128i f = _mm_set1_epi8 ('f'), c = _mm_set1_epi8 ('c');
+  const __m128i k = _mm_set1_epi8 ('k'), b = _mm_set1_epi8 ('b');
+  const __m128i s = _mm_set1_epi8 ('s'), e = _mm_set1_epi8 ('e');
+  size_t i = from;
+  for (; i + 17 <= to; i += 16)
+    {
+      // x 为各位置的第一个字节，y 为第二个字节
+      __m128i x = _mm_loadu_si128 ((const __m128i *)(data + i));
+      __m128i y = _mm_loadu_si128 ((const __m128i *)(data + i + 1));
+      __m128i div = _mm_and_si128 (
+          _mm_cmpeq_epi8 (x, lt),
+          _mm_or_si128 (_mm_cmpeq_epi8 (y, d), _mm_cmpeq_epi8 (y, slash)));
+      __m128i cl = _mm_and_si128 (
+          _mm_cmpeq_epi8 (y, l),
+          _mm_or_si128 (_mm_cmpeq_epi8 (x, f), _mm_cmpeq_epi8 (x, c)));
+      __m128i kb
+          = _mm_and_si128 (_mm_cmpeq_epi8 (x, k), _mm_cmpeq_epi8 (y, b));
+      __m128i se
+          = _mm_and_si128 (_mm_cmpeq_epi8 (x, s), _mm_cmpeq_epi8 (y, e));
+      __m128i hit
+          = _mm_or_si128 (_mm_or_si128 (div, cl), _mm_or_si128 (kb, se));
+      unsigned bits = (unsigned)_mm_movemask_epi8 (hit);
+      for (; bits; bits &= bits - 1)
+        recordMarker (data, i + lowestBit (bits), to, index);
+    }
+  scanMarkersScalar (data, i, to, index);
+}
+
+NCT_TARGET ("avx2")
+void
+scanMarkersAvx2 (const char *data, size_t from, size_t to, MarkerIndex &index)
+{
+  const __m256i lt = _mm256_set1_epi8 ('<'), d = _mm256_set1_epi8 ('d');
+  const __m256i slash = _mm256_set1_epi8 ('/'), l = _mm256_set1_epi8 ('l');
+  const __m256i f = _mm256_set1_epi8 ('f'), c = _mm256_set1_epi8 ('c');
+  const __m256i k = _mm256_set1_epi8 ('k'), b = _mm256_set1_epi8 ('b');
+  const __m256i s = _mm256_set1_epi8 ('s'), e = _mm256_set1_epi8 ('e');
+  size_t i = from;
+  for (; i + 33 <= to; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256 ((const __m256i *)(data + i));
+      __m256i y = _mm256_loadu_si256 ((const __m256i *)(data + i + 1));
+      __m256i div = _mm256_and_si256 (
+          _mm256_cmpeq_epi8 (x, lt),
+          _mm256_or_si256 (_mm256_cmpeq_epi8 (y, d),
+                           _mm256_cmpeq_epi8 (y, slash)));
+      __m256i cl = _mm256_and_si256 (
+          _mm256_cmpeq_epi8 (y, l),
+          _mm256_or_si256 (_mm256_cmpeq_epi8 (x, f),
+                           _mm256_cmpeq_epi8 (x, c)));
+      __m256i kb = _mm256_and_si256 (_mm256_cmpeq_epi8 (x, k),
+                                     _mm256_cmpeq_epi8 (y, b));
+      __m256i se = _mm256_and_si256 (_mm256_cmpeq_epi8 (x, s),
+                                     _mm256_cmpeq_epi8 (y, e));
+      __m256i hit = _mm256_or_si256 (_mm256_or_si256 (div, cl),
+                                     _mm256_or_si256 (kb, se));
+      unsigned bits = (unsigned)_mm256_movemask_epi8 (hit);
+      for (; bits; bits &= bits - 1)
+        recordMarker (data, i + lowestBit (bits), to, index);
+    }
+  scanMarkersSse2 (data, i, to, index);
+}
+
+#ifdef _MSC_VER
+bool
+cpuHasSse2 ()
+{
+  int r[4];
+  __cpuid (r, 1);
+  return (r[3] & (1 << 26)) != 0;
+}
+
+bool
+cpuHasAvx2 ()
+{
+  int r[4];
+  __cpuid (r, 0);
+  if (r[0] < 7)
+    return false;
+  __cpuid (r, 1);
+  bool osxsave = (r[2] & (1 << 27)) != 0; // 系统会保存 YMM 寄存器
+  if (!osxsave || (_xgetbv (0) & 6) != 6)
+    return false;
+  __cpuidex (r, 7, 0);
+  return (r[1] & (1 << 5)) != 0;
+}
+#else
+bool
+cpuHasSse2 ()
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("sse2");
+}
+
+bool
+cpuHasAvx2 ()
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+#endif
+
+#endif // NCT_SIMD_X86
+
+bool
+alwaysSupported ()
+{
+  return true;
+}
+
+struct MarkerScanImpl
+{
+  const char *name;
+  void (*scan) (const char *, size_t, size_t, MarkerIndex &);
+  bool (*supported) ();
+};
+
+// 按优先顺序排列，默认使用第一个 CPU 支持的实现
+const MarkerScanImpl SCAN_IMPLS[] = {
+#ifdef NCT_SIMD_X86
+  { "avx2", scanMarkersAvx2, cpuHasAvx2 },
+  { "sse2", scanMarkersSse2, cpuHasSse2 },
+#endif
+  { "scalar", scanMarkersScalar, alwaysSupported },
+};
+const size_t SCAN_IMPL_COUNT = sizeof SCAN_IMPLS / sizeof SCAN_IMPLS[0];
+
+atomic<const MarkerScanImpl *> scanImpl (NULL);
+
+const MarkerScanImpl *
+currentScanImpl ()
+{
+  const MarkerScanImpl *impl = scanImpl.load ();
+  if (impl)
+    return impl;
+  impl = &SCAN_IMPLS[SCAN_IMPL_COUNT - 1];
+  for (size_t i = 0; i < SCAN_IMPL_COUNT; ++i)
+    if (SCAN_IMPLS[i].supported ())
+      {
+        impl = &SCAN_IMPLS[i];
+        break;
+      }
+  scanImpl.store (impl); // 多个线程同时走到这里时选出的结果相同
+  return impl;
+}
+
+void
+scanMarkers (const char *data, size_t from, size_t to, MarkerIndex &index)
+{
+  for (int i = 0; i < MARK_KINDS; ++i)
+    index.at[i].clear ();
+  if (from < to)
+    currentScanImpl ()->scan (data, from, to, index);
+}
+
+const char *
+markerScanner ()
+{
+  return currentScanImpl ()->name;
+}
+
+bool
+setMarkerScanner (const string &name)
+{
+  for (size_t i = 0; i < SCAN_IMPL_COUNT; ++i)
+    if (name == SCAN_IMPLS[i].name && SCAN_IMPLS[i].supported ())
+      {
+        scanImpl.store (&SCAN_IMPLS[i]);
+        return true;
+      }
+  return false;
+}
+
+// 解析时使用的标记索引，每个线程一份。几 MB 的页面有十几万个标记，
+// 每次重新分配时扩容和触及新内存页的开销与扫描本身相当，因此留着复用
+MarkerIndex &
+scratchMarkers ()
+{
+  static thread_local MarkerIndex index;
+  return index;
+}
+
+// 用完 scratchMarkers 后调用：只在异常大的页面之后释放内存
+void
+releaseScratchMarkers ()
+{
+  const size_t KEEP = 1 << 20; // 最多保留的标记个数
+  MarkerIndex &index = scratchMarkers ();
+  size_t total = 0;
+  for (int i = 0; i < MARK_KINDS; ++i)
+    total += index.at[i].capacity ();
+  if (total > KEEP)
+    for (int i = 0; i < MARK_KINDS; ++i)
+      vector<size_t> ().swap (index.at[i]);
+}
+
+// offsets 中第一个不小于 offset 的元素的下标
+size_t
+firstMarkAt (const vector<size_t> &offsets, size_t offset)
+{
+  return lower_bound (offsets.begin (), offsets.end (), offset)
+         - offsets.begin ();
+}
+
+// 同 firstMarkAt，但从上次的结果 hint 起向后查找，适合查找位置大致
+// 递增的场合；offset 早于 hint 处时重新二分
+size_t
+nextMarkAt (const vector<size_t> &offsets, size_t offset, size_t &hint)
+{
+  if (hint > offsets.size () || (hint > 0 && offsets[hint - 1] >= offset))
+    hint = firstMarkAt (offsets, offset);
+  while (hint < offsets.size () && offsets[hint] < offset)
+    ++hint;
+  return hint;
+}
+
+// offsets 中最后一个不大于 offset 的元素，没有时返回 string::npos
+size_t
+lastMarkAt (const vector<size_t> &offsets, size_t offset)
+{
+  vector<size_t>::const_iterator it
+      = upper_bound (offsets.begin (), offsets.end (), offset);
+  return it == offsets.begin () ? string::npos : it[-1];
+}
+
+// ---- 课表结构扫描器 ----
+// 以下函数替代原先按天、按块反复构造的 std::regex，直接在 [p, end)
+// 字节区间上线性扫描，匹配语义与原正则保持一致。
+
+// 正则 \s 对应的空白字符
+inline bool
+isRegexSpace (char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f'
+         || c == '\r';
+}
+
+// 在 [p, end) 中查找字面量 pat，找不到返回 NULL
+const char *
+findLiteral (const char *p, const char *end, const char *pat, size_t patLen)
+{
+  if (patLen == 0)
+    return p;
+  while (end - p >= (ptrdiff_t)patLen)
+    {
+      const char *hit
+          = (const char *)memchr (p, pat[0], (end - p) - patLen + 1);
+      if (!hit)
+        return NULL;
+      if (memcmp (hit, pat, patLen) == 0)
+        return hit;
+      p = hit + 1;
+    }
+  return NULL;
+}
+
+// 在 [begin, end) 中查找起点不晚于 last 的最后一个 pat，找不到返回 NULL
+const char *
+rfindLiteral (const char *begin, const char *end, const char *last,
+              const char *pat, size_t patLen)
+{
+  if (end - begin < (ptrdiff_t)patLen)
+    return NULL;
+  const char *p = (end - last < (ptrdiff_t)patLen) ? end - patLen : last;
+  for (; p >= begin; --p)
+    if (*p == pat[0] && memcmp (p, pat, patLen) == 0)
+      return p;
+  return NULL;
+}
+
+// 在 [p, end) 中查找第一个后接“周”的 [0-9,-]+ 连续段，
+// 对应原正则 ([0-9\-,]+)周(\((单|双)\))?
+// 成功时 run 为数字段，tokenEnd 为整个匹配（含单双标记）的结尾
+bool
+findWeekToken (const char *p, const char *end, const char *&runBegin,
+               const char *&runEnd, const char *&tokenEnd, int &parity)
+{
+  static const char WEEK[] = "周";
+  static const char ODD[] = "(单)";
+  static const char EVEN[] = "(双)";
+  const size_t weekLen = sizeof (WEEK) - 1;
+  const size_t tagLen = sizeof (ODD) - 1;
+  while (p < end)
+    {
+      char c = *p;
+      if (!((c >= '0' && c <= '9') || c == '-' || c == ','))
+        {
+          ++p;
+          continue;
+        }
+      const char *q = p;
+      while (q < end && ((*q >= '0' && *q <= '9') || *q == '-' || *q == ','))
+        ++q;
+      if ((size_t)(end - q) >= weekLen && memcmp (q, WEEK, weekLen) == 0)
+        {
+          runBegin = p;
+          runEnd = q;
+          tokenEnd = q + weekLen;
+          parity = 0;
+          if ((size_t)(end - tokenEnd) >= tagLen)
+            {
+              if (memcmp (tokenEnd, ODD, tagLen) == 0)
+                parity = 1;
+              else if (memcmp (tokenEnd, EVEN, tagLen) == 0)
+                parity = 2;
+              if (parity)
+                tokenEnd += tagLen;
+            }
+          return true;
+        }
+      p = q;
+    }
+  return false;
+}
+
+// 与 stoi 相同地读出 [p, end) 开头的整数：可带负号，至少一位数字，其后
+// 的字符忽略。没有数字或超出 int 范围时返回 false
+bool
+parseInt (const char *p, const char *end, int &value)
+{
+  bool neg = p < end && *p == '-';
+  if (neg)
+    ++p;
+  if (p == end || !isdigit ((unsigned char)*p))
+    return false;
+  long long v = 0;
+  for (; p < end && isdigit ((unsigned char)*p); ++p)
+    {
+      v = v * 10 + (*p - '0');
+      if (v > (long long)INT_MAX + neg)
+        return false;
+    }
+  value = (int)(neg ? -v : v);
+  return true;
+}
+
+// 解析周数逻辑：处理 1-12周, 9周, 11-13周(单/双) 等
+WeekMask
+parseWeeks (const char *s, size_t n)
+{
+  WeekMask weeks = 0;
+  const char *p = s;
+  const char *sEnd = s + n;
+  const char *runBegin, *runEnd, *tokenEnd;
+  int parity; // 0: 每周, 1: 单周, 2: 双周
+
+  while (findWeekToken (p, sEnd, runBegin, runEnd, tokenEnd, parity))
+    {
+      p = tokenEnd;
+      const char *segBegin = runBegin;
+      while (segBegin <= runEnd)
+        {
+          const char *segEnd = segBegin;
+          while (segEnd < runEnd && *segEnd != ',')
+            ++segEnd;
+          const char *seg = segBegin;
+          segBegin = segEnd + 1;
+          if (seg == segEnd)
+            continue;
+          // 以第一个 '-' 分成起止两段，任一段为空或不是数字时跳过
+          const char *dash = (const char *)memchr (seg, '-', segEnd - seg);
+          int start = 0, end = 0;
+          if (dash)
+            {
+              if (dash == seg || dash + 1 == segEnd
+                  || !parseInt (seg, dash, start)
+                  || !parseInt (dash + 1, segEnd, end))
+                continue;
+            }
+          else
+            {
+              if (!parseInt (seg, segEnd, start))
+                continue;
+              end = start;
+            }
+
+          WeekMask range = weekRange (start, end);
+          if (parity == 1)
+            range &= ODD_WEEKS;
+          else if (parity == 2)
+            range &= EVEN_WEEKS;
+          weeks |= range;
+        }
+    }
+  if (!weeks)
+    weeks = weekRange (1, 16);
+  return weeks;
+}
+
+WeekMask
+parseWeeks (const string &s)
+{
+  return parseWeeks (s.data (), s.size ());
+}
+
+// 判断 [tag, close) 这个开始标签是否匹配原正则
+// <div([^>]+style="[^"]*flex:\s*(\d+)[^"]*"[^>]*)>，tag 指向 "<div"，close
+// 指向第一个 '>'。与贪婪匹配一致，取最后一个可匹配的 style 与 flex。
+bool
+matchSlotTag (const char *tag, const char *close, int &flex, bool &topLevel)
+{
+  static const char STYLE[] = "style=\"";
+  static const char FLEX[] = "flex:";
+  const size_t styleLen = sizeof (STYLE) - 1;
+  const size_t flexLen = sizeof (FLEX) - 1;
+  const char *attrs = tag + 4;
+  const char *digits = NULL;
+
+  // [^>]+ 至少吞掉一个字符，因此 style=" 最早从 attrs + 1 开始
+  if ((size_t)(close - attrs) <= styleLen)
+    return false;
+  for (const char *s = close - styleLen; !digits && s > attrs; --s)
+    {
+      if (memcmp (s, STYLE, styleLen) != 0)
+        continue;
+      const char *vBegin = s + styleLen;
+      const char *vEnd = (const char *)memchr (vBegin, '"', close - vBegin);
+      if (!vEnd)
+        continue;
+      for (size_t i = vEnd - vBegin; !digits && i >= flexLen; --i)
+        {
+          const char *f = vBegin + i - flexLen;
+          if (memcmp (f, FLEX, flexLen) != 0)
+            continue;
+          const char *d = f + flexLen;
+          while (d < vEnd && isRegexSpace (*d))
+            ++d;
+          if (d < vEnd && *d >= '0' && *d <= '9')
+            digits = d;
+        }
+    }
+  if (!digits)
+    return false;
+
+  flex = 0;
+  for (const char *d = digits; *d >= '0' && *d <= '9' && flex < 100000; ++d)
+    flex = flex * 10 + (*d - '0');
+
+  topLevel = (!findLiteral (attrs, close, "class=", 6)
+              || findLiteral (attrs, close, "kbappTimetableDayColumn", 23));
+  return true;
+}
+
+// 文档中一个 <div> 开始标签及其嵌套信息
+struct DivNode
+{
+  size_t open;    // "<div" 的偏移
+  size_t openEnd; // 开始标签 ">" 之后的偏移
+  size_t close;   // 匹配的 "</div" 的偏移，未闭合时为 string::npos
+  int depth;      // 嵌套深度，文档最外层为 0
+  int flex;       // flex 值（代表占用的节数），非课程格子为 0
+  bool slot;      // 是否带 flex 样式（即原 slotRegex 能匹配的格子）
+  bool topLevel;  // 是否为顶层课程块（包含冲突容器和普通课程块）
+  size_t nextTop; // 其后第一个顶层课程块在索引中的下标，没有时为 npos
+};
+
+// 按 marks 中的标记顺序走过文档 doc 的 [from, to)，按出现顺序记录每个
+// <div> 的开闭位置（相对 doc 的偏移）与深度（相对 from 处）。开始标签的
+// 识别规则与原 slotRegex 的迭代方式一致：匹配到课程格子后从 ">" 之后继续，
+// 否则从 "<div" 的下一个字节继续。
+vector<DivNode>
+buildDivIndex (const char *doc, size_t from, size_t to,
+               const MarkerIndex &marks)
+{
+  const vector<size_t> &opens = marks.at[MARK_DIV_OPEN];
+  const vector<size_t> &closes = marks.at[MARK_DIV_CLOSE];
+  const vector<size_t> &flexes = marks.at[MARK_FLEX];
+  const size_t openLen = MARKERS[MARK_DIV_OPEN].len;
+  const size_t closeLen = MARKERS[MARK_DIV_CLOSE].len;
+  vector<DivNode> nodes;
+  vector<size_t> stack; // 尚未闭合的 div 下标
+  const char *end = doc + to;
+  size_t oi = firstMarkAt (opens, from);
+  size_t ci = firstMarkAt (closes, from);
+  size_t fi = firstMarkAt (flexes, from);
+  size_t p = from;
+  while (true)
+    {
+      // 下一个不早于 p、完整落在 to 之前的 "<div" 或 "</div"
+      while (oi < opens.size () && opens[oi] < p)
+        ++oi;
+      while (ci < closes.size () && closes[ci] < p)
+        ++ci;
+      size_t open = (oi < opens.size () && opens[oi] + openLen <= to)
+                        ? opens[oi]
+                        : string::npos;
+      size_t close = (ci < closes.size () && closes[ci] + closeLen <= to)
+                         ? closes[ci]
+                         : string::npos;
+      if (open == string::npos && close == string::npos)
+        break;
+      if (close < open)
+        {
+          if (!stack.empty ())
+            {
+              nodes[stack.back ()].close = close;
+              stack.pop_back ();
+            }
+          p = close + closeLen;
+          continue;
+        }
+      const char *lt = doc + open;
+      const char *gt = (const char *)memchr (lt, '>', end - lt);
+      if (!gt)
+        break;
+
+      DivNode node;
+      node.open = open;
+      node.openEnd = gt + 1 - doc;
+      node.close = string::npos;
+      node.depth = (int)stack.size ();
+      node.flex = 0;
+      node.topLevel = false;
+      node.nextTop = string::npos;
+      // 开始标签内没有 "flex:" 时不可能是课程格子
+      while (fi < flexes.size () && flexes[fi] < open + openLen)
+        ++fi;
+      node.slot = fi < flexes.size ()
+                  && flexes[fi] + MARKERS[MARK_FLEX].len <= node.openEnd - 1
+                  && matchSlotTag (lt, gt, node.flex, node.topLevel);
+      stack.push_back (nodes.size ());
+      nodes.push_back (node);
+      p = node.slot ? node.openEnd : open + 1;
+    }
+
+  // 反向填充 nextTop，使每个块的结束位置成为 O(1) 查询
+  size_t next = string::npos;
+  for (size_t i = nodes.size (); i-- > 0;)
+    {
+      nodes[i].nextTop = next;
+      if (nodes[i].slot && nodes[i].topLevel)
+        next = i;
+    }
+  return nodes;
+}
+
+// 返回第一个起点不早于 offset 的 div 在索引中的下标
+size_t
+firstDivAt (const vector<DivNode> &nodes, size_t offset)
+{
+  size_t lo = 0, hi = nodes.size ();
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (nodes[mid].open < offset)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+// 一次 class="xxx...">文本</div> 形式的匹配
+struct TextDivMatch
+{
+  const char *begin;    // 匹配起点（class= 处）
+  const char *end;      // 匹配终点（</div> 之后）
+  const char *capBegin; // 文本起点
+  const char *capEnd;   // 文本终点（已去除首尾空白）
+};
+
+// 在 [p, end) 中查找 marker[^"]*">\s*([\s\S]+?)\s*</div>，marker 为
+// class="title 等标记之一，hits 为它在 base 起的页面中的全部位置，hint
+// 为上次查找的结果。回溯语义与 ECMAScript 正则一致。
+bool
+findTextDiv (const char *base, const vector<size_t> &hits, size_t markerLen,
+             size_t &hint, const char *p, const char *end, TextDivMatch &m)
+{
+  static const char CLOSE[] = "</div>";
+  const size_t closeLen = sizeof (CLOSE) - 1;
+  for (size_t i = nextMarkAt (hits, p - base, hint); i < hits.size (); ++i)
+    {
+      const char *hit = base + hits[i];
+      if (end - hit < (ptrdiff_t)markerLen)
+        return false;
+
+      const char *q = hit + markerLen;
+      const char *quote = (const char *)memchr (q, '"', end - q);
+      if (!quote || quote + 1 >= end || quote[1] != '>')
+        continue;
+      const char *s = quote + 2;
+      while (s < end && isRegexSpace (*s))
+        ++s;
+
+      const char *d = (s < end) ? findLiteral (s + 1, end, CLOSE, closeLen)
+                                : NULL;
+      if (d)
+        {
+          const char *e = d;
+          while (e > s + 1 && isRegexSpace (e[-1]))
+            --e;
+          m.capBegin = s;
+          m.capEnd = e;
+        }
+      else if (s > quote + 2 && (size_t)(end - s) >= closeLen
+               && memcmp (s, CLOSE, closeLen) == 0)
+        {
+          // 标签内只有空白：回溯后捕获最后一个空白字符
+          d = s;
+          m.capBegin = s - 1;
+          m.capEnd = s;
+        }
+      else
+        continue;
+
+      m.begin = hit;
+      m.end = d + closeLen;
+      return true;
+    }
+  return false;
+}
+
+// 提取学期信息，对应原正则 selected="">([^<]+学年 [^<]+)\(当前\)
+// 再截去第一个 "(" 之后的部分。hit 指向一处 selected="">，不匹配时
+// 返回 false
+bool
+matchSemester (const char *hit, const char *end, string &semesterInfo)
+{
+  static const char SEL[] = "selected=\"\">";
+  static const char YEAR[] = "学年 ";
+  static const char CUR[] = "(当前)";
+  const char *segBegin = hit + sizeof (SEL) - 1;
+  const char *segEnd = (const char *)memchr (segBegin, '<', end - segBegin);
+  if (!segEnd)
+    segEnd = end;
+
+  const char *year
+      = findLiteral (segBegin + 1, segEnd, YEAR, sizeof (YEAR) - 1);
+  if (!year)
+    return false;
+  const char *cur = NULL;
+  for (const char *c = findLiteral (segBegin, segEnd, CUR, sizeof (CUR) - 1);
+       c; c = findLiteral (c + 1, segEnd, CUR, sizeof (CUR) - 1))
+    cur = c;
+  if (!cur || cur < year + (sizeof (YEAR) - 1) + 1)
+    return false;
+
+  const char *paren = (const char *)memchr (segBegin, '(', cur - segBegin);
+  semesterInfo.assign (segBegin, paren ? paren : cur);
+  return true;
+}
+
+// 在 [p, end) 中逐个尝试 selected="">，直到提取出学期信息
+bool
+extractSemester (const char *p, const char *end, string &semesterInfo)
+{
+  const MarkerPattern &sel = MARKERS[MARK_SELECTED];
+  for (const char *hit = findLiteral (p, end, sel.text, sel.len); hit;
+       hit = findLiteral (hit + 1, end, sel.text, sel.len))
+    if (matchSemester (hit, end, semesterInfo))
+      return true;
+  return false;
+}
+
+// 地点在 s 中的位置：从校区关键字（没有时从开头）到末尾，去掉首尾空白
+void
+locationRange (const string &s, size_t &begin, size_t &len)
+{
+  size_t pos = s.find ("浑南校区");
+  if (pos == string::npos)
+    pos = s.find ("南湖校区");
+  if (pos == string::npos)
+    pos = 0;
+  begin = s.find_first_not_of (" \n\r\t", pos);
+  if (begin == string::npos)
+    {
+      begin = len = 0;
+      return;
+    }
+  len = s.find_last_not_of (" \n\r\t") + 1 - begin;
+}
+
+// ---- 日历计算 ----
+// 纯整数的公历日期运算，与时区无关且可重入，取代逐个事件的
+// mktime/localtime 往返。
+
+// 公历日期距 1970-01-01 的天数（Howard Hinnant 的 days_from_civil）
+long long
+daysFromCivil (long long y, int m, int d)
+{
+  // 先把月份规范到 1-12，与 mktime 对越界月份的处理一致
+  y += (m - 1) / 12;
+  m = (m - 1) % 12 + 1;
+  if (m < 1)
+    {
+      m += 12;
+      --y;
+    }
+  y -= m <= 2;
+  long long era = (y >= 0 ? y : y - 399) / 400;
+  long long yoe = y - era * 400;                                // [0, 399]
+  long long doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1; // 年内第几天
+  long long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;        // [0, 146096]
+  return era * 146097 + doe - 719468;
+}
+
+// daysFromCivil 的逆运算
+void
+civilFromDays (long long z, long long &y, int &m, int &d)
+{
+  z += 719468;
+  long long era = (z >= 0 ? z : z - 146096) / 146097;
+  long long doe = z - era * 146097;
+  long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  long long mp = (5 * doy + 2) / 153;
+  d = (int)(doy - (153 * mp + 2) / 5 + 1);
+  m = (int)(mp < 10 ? mp + 3 : mp - 9);
+  y = yoe + era * 400 + (m <= 2);
+}
+
+SemesterCalendar::SemesterCalendar (const string &startSunday)
+{
+  int y, m, d;
+  char sep1, sep2;
+  valid_ = sscanf (startSunday.c_str (), "%d %c%d %c%d", &y, &sep1, &m, &sep2,
+                   &d)
+               == 5
+           && y >= 1 && y <= 9998; // 加上整学期后仍是四位数的年份
+  epochDay_ = valid_ ? daysFromCivil (y, m, d) : 0;
+  for (int i = 0; i < TABLE_DAYS; ++i)
+    format (i, table_[i]);
+}
+
+void
+SemesterCalendar::format (int offset, char *out) const
+{
+  if (!valid_)
+    {
+      memcpy (out, "19700101", 9);
+      return;
+    }
+  long long y;
+  int m, d;
+  civilFromDays (epochDay_ + offset, y, m, d);
+  // 表外的偏移仍可能越出四位数年份，这时与无法解析的日期一样处理，
+  // 不截断成错误的日期
+  char buf[48];
+  if (snprintf (buf, sizeof buf, "%04lld%02d%02d", y, m, d) != 8)
+    memcpy (buf, "19700101", 9);
+  memcpy (out, buf, 9);
+}
+
+// 各节课的起止时间
+const char *const PERIOD_START[] = {
+  "000000", "083000", "092500", "103000", "112500", "140000", "145500",
+  "160000", "165500", "183000", "192500", "203000", "212500",
+};
+const char *const PERIOD_END[] = {
+  "000000", "091500", "101000", "111500", "121000", "144500", "154000",
+  "164500", "174000", "191500", "201000", "211500", "221000",
+};
+
+const char *
+getTime (int period, bool isStart)
+{
+  if (period < 1 || period > 12)
+    return "000000";
+  return isStart ? PERIOD_START[period] : PERIOD_END[period];
+}
+
+// 按列标记把页面切成每天一段，返回各段相对 data 的 [起点, 终点)
+DayRanges
+splitDayColumns (const char *data, size_t size)
+{
+  MarkerIndex &marks = scratchMarkers ();
+  scanMarkers (data, 0, size, marks);
+  DayRanges dayRanges = splitDayColumns (data, size, marks);
+  releaseScratchMarkers ();
+  return dayRanges;
+}
+
+// 同上，marks 为整个页面的标记
+DayRanges
+splitDayColumns (const char *data, size_t size, const MarkerIndex &marks)
+{
+  const vector<size_t> &cols = marks.at[MARK_COLUMN]; // 列标记
+  const vector<size_t> &opens = marks.at[MARK_DIV_OPEN];
+  const vector<size_t> &closes = marks.at[MARK_DIV_CLOSE];
+  const char *end = data + size;
+  DayRanges dayRanges; // 每一天 HTML 片段的区间
+  // 抓够 7 天则强制退出
+  for (size_t i = 0; i < cols.size () && dayRanges.size () < 7; ++i)
+    {
+      size_t startDiv = lastMarkAt (opens, cols[i]); // 向上寻找 div 的开始
+      if (startDiv == string::npos)
+        startDiv = 0;
+      size_t nextPos = size; // 保守方案：截取到文件末尾
+      if (i + 1 == cols.size ())
+        {
+          // 若是最后一列，寻找闭合标签（兼容 Windows 下的 \r\n 换行）
+          for (size_t j = firstMarkAt (closes, cols[i]); j < closes.size ();
+               ++j)
+            {
+              const char *hit = data + closes[j];
+              const char *after = hit + 6;
+              if (after < end && hit[5] == '>'
+                  && (*after == '\n'
+                      || (*after == '\r' && after + 1 < end
+                          && after[1] == '\n')))
+                {
+                  nextPos = closes[j];
+                  break;
+                }
+            }
+        }
+      else
+        {
+          nextPos = lastMarkAt (opens, cols[i + 1]); // 下一列 div 的起始
+          if (nextPos == string::npos)
+            nextPos = size;
+        }
+      dayRanges.push_back (make_pair (startDiv, nextPos)); // 记录该天的区间
+    }
+  return dayRanges;
+}
+
+// 从切好的各天区间中逐个格子提取课程标题与详情，追加到 courses，各字段
+// 驻留在 strings 中。dayRanges 的第一段为星期 firstDay（0 为周日）
+void
+extractCourses (const char *data, const DayRanges &dayRanges,
+                vector<Course> &courses, StringPool &strings, RunStats *stats,
+                int firstDay, const MarkerIndex *marks)
+{
+  // 对课表所在区间只建立一次 div 嵌套索引
+  const char *base = data;
+  vector<DivNode> divs;
+  bool ownMarks = !marks;
+  if (ownMarks)
+    marks = &scratchMarkers ();
+  StageTimer slotTimer (stats, STAGE_SLOTS);
+  if (!dayRanges.empty ())
+    {
+      size_t from = dayRanges.front ().first, to = dayRanges.back ().second;
+      if (ownMarks)
+        scanMarkers (base, from, to, scratchMarkers ());
+      divs = buildDivIndex (base, from, to, *marks);
+      slotTimer.stop (to - from);
+    }
+  else if (ownMarks)
+    scanMarkers (base, 0, 0, scratchMarkers ()); // 清掉上次的结果
+  slotTimer.stop (0);
+  const vector<size_t> &titleHits = marks->at[MARK_TITLE];
+  const vector<size_t> &infoHits = marks->at[MARK_INFO];
+  const size_t titleLen = MARKERS[MARK_TITLE].len;
+  const size_t infoLen = MARKERS[MARK_INFO].len;
+  size_t titleHint = 0, infoHint = 0;
+
+  // 提取耗时扣除其中的周数解析，使各步骤耗时之和等于总耗时
+  unsigned long long extractStart = stats ? monotonicNs () : 0;
+  unsigned long long weeksBefore = stats ? stats->stages[STAGE_WEEKS].ns : 0;
+  unsigned long long extractBytes = 0;
+
+  // 逐门课复用的缓冲区，只有最终的字段驻留到 strings 中
+  string title, info, teacher, cleaned, description;
+  for (int dayIndex = 0; dayIndex < (int)dayRanges.size (); ++dayIndex)
+    {
+      size_t dayStart = dayRanges[dayIndex].first; // 当天 HTML 的区间
+      size_t dayEnd = dayRanges[dayIndex].second;
+
+      int currentPeriod = 1;     // 当前节数计数器
+      bool skippedRoot = false; // 是否已跳过最外层的列容器 div
+      for (size_t di = firstDivAt (divs, dayStart); di < divs.size (); ++di)
+        {
+          const DivNode &slot = divs[di];
+          if (slot.openEnd > dayEnd)
+            break; // 超出当天区间
+          if (!slot.slot)
+            continue; // 不带 flex 样式的 div
+          if (!skippedRoot)
+            {
+              skippedRoot = true;
+              continue;
+            }
+          int flex = slot.flex;
+          if (!slot.topLevel)
+            continue; // 非顶层块则跳过
+
+          // 当前块的结束位置：下一个顶层块的起点，或当天结尾
+          size_t startPos = slot.openEnd;
+          size_t endPos = dayEnd;
+          if (slot.nextTop != string::npos
+              && divs[slot.nextTop].openEnd <= dayEnd)
+            endPos = divs[slot.nextTop].open;
+          const char *innerBegin = base + startPos;
+          const char *innerEnd = base + endPos;
+          if (stats)
+            {
+              ++stats->slots;
+              extractBytes += endPos - startPos;
+            }
+
+          TextDivMatch tm, tmNext = TextDivMatch ();
+          bool hasTitle
+              = findTextDiv (base, titleHits, titleLen, titleHint, innerBegin,
+                             innerEnd, tm); // 匹配课程标题
+          for (; hasTitle; tm = tmNext)
+            {
+              bool hasNext
+                  = findTextDiv (base, titleHits, titleLen, titleHint,
+                                 tm.end, innerEnd, tmNext);
+              const char *blockStart = tm.end;
+              const char *blockEnd = hasNext ? tmNext.begin : innerEnd;
+              hasTitle = hasNext;
+
+              Course c;
+              c.day = firstDay + dayIndex;            // 记录星期
+              c.startPeriod = currentPeriod;          // 记录起始节数
+              c.endPeriod = currentPeriod + flex - 1; // 计算结束节数
+              c.weeks = 0; // 没有详情行时不生成任何周
+              title.clear ();
+              clean (tm.capBegin, tm.capEnd, title); // 提取并清理标题
+              if (stats)
+                ++stats->titles;
+
+              // 过滤掉非课程的页面干扰项
+              if (title == "我的应用" || title == "公告消息情况"
+                  || title == "学习日程"
+                  || title.find ("2026-") != string::npos)
+                {
+                  if (stats)
+                    ++stats->filteredTitles;
+                  continue;
+                }
+
+              TextDivMatch im; // 匹配详情文字
+              bool firstInfo = true;
+              description.clear ();
+              for (const char *ip = blockStart;
+                   findTextDiv (base, infoHits, infoLen, infoHint, ip,
+                                blockEnd, im);
+                   ip = im.end)
+                {
+                  info.clear ();
+                  clean (im.capBegin, im.capEnd, info); // 清理信息文字
+                  if (info.empty ())
+                    continue;
+                  if (firstInfo)
+                    {
+                      // 1. 提取周数部分
+                      const char *runBegin, *runEnd, *tokenEnd;
+                      int parity;
+                      if (findWeekToken (info.data (),
+                                         info.data () + info.size (),
+                                         runBegin, runEnd, tokenEnd, parity))
+                        c.weekStr
+                            = strings.intern (runBegin, tokenEnd - runBegin);
+
+                      StageTimer weeksTimer (stats, STAGE_WEEKS);
+                      c.weeks = parseWeeks (info); // 解析周数位图
+                      weeksTimer.stop (info.size ());
+                      size_t locBegin, locLen; // 提取地点
+                      locationRange (info, locBegin, locLen);
+                      c.location = strings.intern (info.data () + locBegin,
+                                                   locLen);
+
+                      // 2. 提取教师姓名
+                      // (从第一行中剔除周数和地点关键字后的部分)
+                      teacher = info;
+                      if (!c.weekStr.empty ())
+                        {
+                          size_t wpos = teacher.find (c.weekStr.data (), 0,
+                                                      c.weekStr.size ());
+                          if (wpos != string::npos)
+                            teacher.erase (wpos, c.weekStr.size ());
+                        }
+                      size_t locKeyPos = teacher.find ("浑南校区");
+                      if (locKeyPos == string::npos)
+                        locKeyPos = teacher.find ("南湖校区");
+                      if (locKeyPos != string::npos)
+                        {
+                          teacher.erase (locKeyPos);
+                        }
+                      else if (!c.location.empty ())
+                        {
+                          size_t lpos = teacher.find (c.location.data (), 0,
+                                                      c.location.size ());
+                          if (lpos != string::npos)
+                            teacher.erase (lpos, c.location.size ());
+                        }
+                      cleaned.clear ();
+                      clean (teacher.data (),
+                             teacher.data () + teacher.size (), cleaned);
+                      if (!cleaned.empty ())
+                        {
+                          if (!description.empty ())
+                            description += ",";
+                          description += cleaned;
+                        }
+
+                      firstInfo = false;
+                    }
+                  else
+                    {
+                      if (!description.empty ())
+                        description += ",";
+                      description += info; // 拼接其他信息（通常是教师）
+                    }
+                }
+              if (!title.empty ())
+                {
+                  c.title = strings.intern (title);
+                  c.description = strings.intern (description);
+                  courses.push_back (c); // 加入课程列表
+                }
+            }
+          currentPeriod += flex; // 更新当前节数
+        }
+    }
+
+  if (stats)
+    {
+      StageStats &e = stats->stages[STAGE_EXTRACT];
+      e.ns += monotonicNs () - extractStart
+              - (stats->stages[STAGE_WEEKS].ns - weeksBefore);
+      e.bytes += extractBytes;
+      ++e.calls;
+    }
+  if (ownMarks)
+    releaseScratchMarkers ();
+}
+
+// 从课表页面的 HTML 中提取全部课程。[data, data + size) 通常是映射到内存的
+// 文件，解析全程只在其上做偏移运算，只有最终的 Course 字段会被复制出来。
+Schedule
+parseSchedule (const char *data, size_t size, RunStats *stats)
+{
+  // 整个页面只扫描一次，切分列、学期信息和各天的格子都用这份标记
+  StageTimer splitTimer (stats, STAGE_SPLIT);
+  MarkerIndex &marks = scratchMarkers ();
+  scanMarkers (data, 0, size, marks);
+  DayRanges dayRanges = splitDayColumns (data, size, marks);
+
+  Schedule sched;                        // 解析结果
+  sched.semesterInfo = "2025-2026 秋季"; // 默认值
+  sched.strings = make_shared<StringPool> ();
+
+  // 尝试提取学期信息
+  const vector<size_t> &sels = marks.at[MARK_SELECTED];
+  for (size_t i = 0; i < sels.size (); ++i)
+    if (matchSemester (data + sels[i], data + size, sched.semesterInfo))
+      break;
+  splitTimer.stop (size);
+  if (stats)
+    stats->days += dayRanges.size ();
+
+  extractCourses (data, dayRanges, sched.courses, *sched.strings, stats, 0,
+                  &marks);
+  releaseScratchMarkers ();
+  return sched;
+}
+
+StreamParser::StreamParser (RunStats *stats)
+    : stats_ (stats), base_ (0), peak_ (0), semesterFound_ (false),
+      semesterScan_ (0), markScan_ (0), closeScan_ (0), pending_ (false),
+      colStart_ (0), colMark_ (0), days_ (0), done_ (false)
+{
+  sched_.semesterInfo = "2025-2026 秋季"; // 与 parseSchedule 相同的默认值
+  sched_.strings = make_shared<StringPool> ();
+}
+
+void
+StreamParser::feed (const char *data, size_t size)
+{
+  buf_.append (data, size);
+  if (buf_.size () > peak_)
+    peak_ = buf_.size ();
+  process (false, size);
+}
+
+Schedule
+StreamParser::finish ()
+{
+  process (true, 0);
+  string ().swap (buf_);
+  return sched_;
+}
+
+// 与 extractSemester 相同的查找。命中处之后直到 '<' 的文字还没收全时
+// 停在命中处，等待更多输入
+void
+StreamParser::scanSemester (bool eof)
+{
+  static const char SEL[] = "selected=\"\">";
+  const size_t selLen = sizeof (SEL) - 1;
+  const char *end = buf_.data () + buf_.size ();
+  while (!semesterFound_)
+    {
+      const char *hit = findLiteral (at (semesterScan_), end, SEL, selLen);
+      if (!hit)
+        {
+          if (buf_.size () >= selLen) // 末尾可能是半个标记
+            semesterScan_
+                = max (semesterScan_, offsetOf (end - (selLen - 1)));
+          return;
+        }
+      const char *segBegin = hit + selLen;
+      const char *segEnd
+          = (const char *)memchr (segBegin, '<', end - segBegin);
+      if (!segEnd && !eof)
+        {
+          semesterScan_ = offsetOf (hit);
+          return;
+        }
+      semesterFound_ = extractSemester (hit, segEnd ? segEnd + 1 : end,
+                                        sched_.semesterInfo);
+      semesterScan_ = offsetOf (hit) + 1;
+    }
+}
+
+// 在 [closeScan_, limit) 中查找当前列的闭合标签，即 splitDayColumns 对
+// 最后一列使用的、其后紧跟换行的 "</div>"。找到返回 1；确定没有返回 0；
+// 还要更多输入才能确定时返回 -1
+int
+StreamParser::findColumnClose (const char *limit, bool eof, size_t &close)
+{
+  const char *end = buf_.data () + buf_.size ();
+  for (const char *hit = findLiteral (at (closeScan_), limit, "</div>", 6);
+       hit; hit = findLiteral (hit + 1, limit, "</div>", 6))
+    {
+      const char *after = hit + 6;
+      if (after < end
+          && (*after == '\n'
+              || (*after == '\r' && after + 1 < end && after[1] == '\n')))
+        {
+          close = offsetOf (hit);
+          return 1;
+        }
+      if (!eof && (after >= end || (*after == '\r' && after + 1 >= end)))
+        {
+          closeScan_ = offsetOf (hit);
+          return -1;
+        }
+    }
+  if (limit < end || eof)
+    return 0;
+  if (buf_.size () >= 5) // 末尾可能是半个 "</div>"
+    closeScan_ = max (closeScan_, offsetOf (end - 5));
+  return -1;
+}
+
+// 与 splitDayColumns 相同地切分各列，把已确定的区间追加到 ready
+void
+StreamParser::scanColumns (bool eof, DayRanges &ready)
+{
+  static const char COL_MARK[] = "kbappTimetableDayColumnRoot"; // 列标记
+  const size_t colLen = sizeof (COL_MARK) - 1;
+  while (!done_)
+    {
+      const char *end = buf_.data () + buf_.size ();
+      const char *mark = findLiteral (at (markScan_), end, COL_MARK, colLen);
+      if (!mark && buf_.size () >= colLen) // 末尾可能是半个标记
+        markScan_ = max (markScan_, offsetOf (end - (colLen - 1)));
+      const char *div
+          = mark ? rfindLiteral (buf_.data (), end, mark, "<div", 4) : NULL;
+      size_t nextStart = div ? offsetOf (div) : base_;
+      size_t colEnd;
+
+      if (pending_ && days_ == 6)
+        {
+          // 第七列：闭合标签与下一个列标记，先出现者为终点
+          int found = findColumnClose (mark ? mark : end, eof, colEnd);
+          if (found < 0)
+            return;
+          if (mark && (!found || nextStart < colEnd))
+            colEnd = nextStart;
+          else if (!found)
+            colEnd = offsetOf (end);
+          ready.push_back (make_pair (colStart_, colEnd));
+          ++days_;
+          pending_ = false;
+          done_ = true;
+          return;
+        }
+
+      if (!mark)
+        {
+          if (!eof)
+            return;
+          if (pending_)
+            {
+              if (!findColumnClose (end, true, colEnd))
+                colEnd = offsetOf (end); // 保守方案：截取到输入末尾
+              ready.push_back (make_pair (colStart_, colEnd));
+              ++days_;
+              pending_ = false;
+            }
+          done_ = true;
+          return;
+        }
+
+      if (pending_)
+        {
+          ready.push_back (make_pair (colStart_, nextStart));
+          ++days_;
+        }
+      pending_ = true;
+      colStart_ = nextStart;
+      colMark_ = offsetOf (mark);
+      closeScan_ = colMark_;
+      markScan_ = colMark_ + colLen;
+    }
+}
+
+void
+StreamParser::process (bool eof, size_t fed)
+{
+  DayRanges ready;
+  int firstDay = days_;
+  StageTimer splitTimer (stats_, STAGE_SPLIT);
+  scanSemester (eof);
+  scanColumns (eof, ready);
+  splitTimer.stop (fed);
+
+  if (!ready.empty ())
+    {
+      for (size_t i = 0; i < ready.size (); ++i)
+        {
+          ready[i].first -= base_;
+          ready[i].second -= base_;
+        }
+      if (stats_)
+        stats_->days += ready.size ();
+      extractCourses (buf_.data (), ready, sched_.courses, *sched_.strings,
+                      stats_, firstDay);
+    }
+
+  // 丢掉之后不会再用到的数据：未完成的列、学期信息的查找起点，以及下一列
+  // 可能的起点（最后一个 "<div"）之前的部分
+  size_t keep = base_ + buf_.size ();
+  if (!semesterFound_)
+    keep = min (keep, semesterScan_);
+  if (pending_)
+    keep = min (keep, colStart_);
+  else if (!done_)
+    {
+      keep = min (keep, markScan_);
+      const char *end = buf_.data () + buf_.size ();
+      const char *div = NULL;
+      if (markScan_ > base_)
+        div = rfindLiteral (buf_.data (), end, at (markScan_) - 1, "<div", 4);
+      if (div)
+        keep = min (keep, offsetOf (div));
+    }
+  if (keep > base_)
+    {
+      buf_.erase (0, keep - base_);
+      base_ = keep;
+    }
+}
+
+// 周数位图压缩成一条重复规则：起始周、间隔（1 为每周，2 为单/双周）、
+// 覆盖的周数，以及落在规则内但不上课、需要用 EXDATE 排除的周
+struct WeeklyRule
+{
+  int first;
+  int interval;
+  int count;
+  WeekMask gaps;
+};
+
+WeeklyRule
+detectWeeklyRule (WeekMask weeks)
+{
+  WeeklyRule r;
+  r.first = lowestWeek (weeks);
+  int last = highestWeek (weeks);
+  // 所有周同奇偶时按隔周重复，否则按每周重复，再用 EXDATE 补空缺
+  WeekMask parity = (r.first % 2) ? ODD_WEEKS : EVEN_WEEKS;
+  r.interval = (weeks & ~parity) ? 1 : 2;
+  if (r.first == last)
+    r.interval = 1;
+  r.count = (last - r.first) / r.interval + 1;
+  WeekMask covered = weekRange (r.first, last);
+  if (r.interval == 2)
+    covered &= parity;
+  r.gaps = covered & ~weeks;
+  return r;
+}
+
+// 64 位 FNV-1a 散列
+uint64_t
+fnv1a (const string &s, uint64_t h = 14695981039346656037ULL)
+{
+  for (size_t i = 0; i < s.size (); ++i)
+    {
+      h ^= (unsigned char)s[i];
+      h *= 1099511628211ULL;
+    }
+  return h;
+}
+
+// 由课程名、星期、节次和周数得到确定的 UID，重新生成时保持不变。
+// 同一份课表中完全相同的键按出现顺序追加序号 n 区分
+string
+uidKey (const Course &c, int week)
+{
+  char buf[64];
+  int n = snprintf (buf, sizeof buf, "\x1f%d\x1f%d\x1f%d\x1f%d", c.day,
+                    c.startPeriod, c.endPeriod, week);
+  string key;
+  key.reserve (c.title.size () + n);
+  key.append (c.title.data (), c.title.size ());
+  key.append (buf, n);
+  return key;
+}
+
+string
+makeUid (const string &key, int n)
+{
+  char buf[40];
+  uint64_t h = fnv1a (key);
+  if (n > 0)
+    h = fnv1a ("\x1f" + to_string (n), h);
+  snprintf (buf, sizeof buf, "%016llx@neu-course-table",
+            (unsigned long long)h);
+  return buf;
+}
+
+// 写出一个 VEVENT 的公共部分（标题、地点、详情与首次上课时间）
+void
+writeEventHeader (ostream &ics, const Course &c, const char *date)
+{
+  ics << "SUMMARY:" << c.title << "\n";           // 写入标题
+  ics << "LOCATION:" << c.location << "\n";       // 写入地点
+  ics << "DESCRIPTION:" << c.description << "\n"; // 写入详情
+  ics << "DTSTART:" << date << "T" << getTime (c.startPeriod, true)
+      << "\n"; // 写入开始时间
+  ics << "DTEND:" << date << "T" << getTime (c.endPeriod, false)
+      << "\n"; // 写入结束时间
+}
+
+// 一门课的 VEVENT，不含 UID 的序号等与所在课表有关的部分，返回上课
+// 次数。默认每门课一个带 RRULE 的事件；expanded 为 true 时按旧格式
+// 每周展开成独立的事件。body 只是复用的缓冲区
+int
+renderCourseEvents (const Course &c, const SemesterCalendar &calendar,
+                    bool expanded, ostringstream &body,
+                    vector<CourseEvent> &out)
+{
+  char buf[32]; // 超出预计算范围时的日期缓冲
+  if (!c.weeks)
+    return 0;
+  if (expanded)
+    {
+      int n = 0;
+      for (WeekMask m = c.weeks; m; m &= m - 1) // 逐个取出最低位的周
+        {
+          int week = lowestWeek (m);
+          body.str ("");
+          writeEventHeader (body, c, calendar.date (week, c.day, buf));
+          CourseEvent ev;
+          ev.uidKey = uidKey (c, week);
+          ev.uid = makeUid (ev.uidKey, 0);
+          ev.body = body.str ();
+          out.push_back (std::move (ev));
+          n++; // 计数
+        }
+      return n;
+    }
+
+  WeeklyRule rule = detectWeeklyRule (c.weeks);
+  body.str ("");
+  writeEventHeader (body, c, calendar.date (rule.first, c.day, buf));
+  if (rule.count > 1)
+    body << "RRULE:FREQ=WEEKLY;INTERVAL=" << rule.interval
+         << ";COUNT=" << rule.count << "\n";
+  // 每个空缺周单独一行 EXDATE，避免超出 75 字节的行长限制
+  const char *startTime = getTime (c.startPeriod, true);
+  for (WeekMask m = rule.gaps; m; m &= m - 1)
+    body << "EXDATE:" << calendar.date (lowestWeek (m), c.day, buf) << "T"
+         << startTime << "\n";
+  CourseEvent ev;
+  ev.uidKey = uidKey (c, rule.first);
+  ev.uid = makeUid (ev.uidKey, 0);
+  ev.body = body.str ();
+  out.push_back (std::move (ev));
+  return rule.count - weekCount (rule.gaps);
+}
+
+// 把一门课的事件加入课表的事件列表，补上 UID 的序号
+void
+addCourseEvents (const vector<CourseEvent> &course, map<string, int> &seen,
+                 vector<IcsEvent> &events)
+{
+  for (size_t i = 0; i < course.size (); ++i)
+    {
+      const CourseEvent &ce = course[i];
+      int n = seen[ce.uidKey]++;
+      IcsEvent ev;
+      ev.uid = n ? makeUid (ce.uidKey, n) : ce.uid;
+      ev.sequence = 0;
+      ev.body = ce.body;
+      events.push_back (std::move (ev));
+    }
+}
+
+// 同上，course 只是临时的缓冲区，UID 与正文直接移入事件列表
+void
+addCourseEvents (vector<CourseEvent> &&course, map<string, int> &seen,
+                 vector<IcsEvent> &events)
+{
+  for (size_t i = 0; i < course.size (); ++i)
+    {
+      CourseEvent &ce = course[i];
+      int n = seen[ce.uidKey]++;
+      IcsEvent ev;
+      if (n)
+        ev.uid = makeUid (ce.uidKey, n);
+      else
+        ev.uid.swap (ce.uid);
+      ev.sequence = 0;
+      ev.body.swap (ce.body);
+      events.push_back (std::move (ev));
+    }
+}
+
+// 把课程转换成 VEVENT 列表，返回其中的上课次数
+int
+buildIcsEvents (const vector<Course> &courses, const string &startSunday,
+                bool expanded, vector<IcsEvent> &events)
+{
+  SemesterCalendar calendar (startSunday); // 起始日期只解析一次
+  map<string, int> seen;
+  ostringstream body;
+  vector<CourseEvent> course;
+  int totalEvents = 0;
+  for (const auto &c : courses)
+    {
+      course.clear ();
+      totalEvents += renderCourseEvents (c, calendar, expanded, body, course);
+      addCourseEvents (std::move (course), seen, events);
+    }
+  return totalEvents;
+}
+
+// 同上，各教学班的事件已经生成好
+int
+buildIcsEvents (const vector<const Section *> &sections,
+                vector<IcsEvent> &events)
+{
+  map<string, int> seen;
+  int totalEvents = 0;
+  for (size_t i = 0; i < sections.size (); ++i)
+    {
+      totalEvents += sections[i]->classes;
+      addCourseEvents (sections[i]->events, seen, events);
+    }
+  return totalEvents;
+}
+
+// 读回上一次生成的 ICS 中的事件，用于延续 SEQUENCE 和计算增量
+void
+readIcsEvents (istream &in, vector<IcsEvent> &events)
+{
+  string line;
+  IcsEvent ev;
+  bool inEvent = false;
+  while (getline (in, line))
+    {
+      if (!line.empty () && line[line.size () - 1] == '\r')
+        line.erase (line.size () - 1);
+      if (line == "BEGIN:VEVENT")
+        {
+          inEvent = true;
+          ev.uid.clear ();
+          ev.sequence = 0;
+          ev.body.clear ();
+        }
+      else if (!inEvent)
+        continue;
+      else if (line == "END:VEVENT")
+        {
+          inEvent = false;
+          if (!ev.uid.empty ())
+            events.push_back (ev);
+        }
+      else if (line.compare (0, 4, "UID:") == 0)
+        ev.uid = line.substr (4);
+      else if (line.compare (0, 9, "SEQUENCE:") == 0)
+        ev.sequence = atoi (line.c_str () + 9);
+      else if (line.compare (0, 8, "DTSTAMP:") != 0
+               && line.compare (0, 7, "STATUS:") != 0)
+        ev.body += line + "\n";
+    }
+}
+
+// 对照上一次的事件集合：未变的事件沿用原 SEQUENCE，有变化的加一。
+// delta 不为空时收集新增、变更的事件，以及已不存在、需标记为
+// STATUS:CANCELLED 的事件
+IcsDelta
+applyPrevious (vector<IcsEvent> &events, const vector<IcsEvent> &previous,
+               vector<IcsEvent> *delta, vector<IcsEvent> *cancelled)
+{
+  IcsDelta d = { 0, 0, 0 };
+  map<string, const IcsEvent *> prev;
+  for (size_t i = 0; i < previous.size (); ++i)
+    prev[previous[i].uid] = &previous[i];
+  for (size_t i = 0; i < events.size (); ++i)
+    {
+      IcsEvent &ev = events[i];
+      map<string, const IcsEvent *>::iterator it = prev.find (ev.uid);
+      if (it == prev.end ())
+        {
+          ++d.added;
+          if (delta)
+            delta->push_back (ev);
+          continue;
+        }
+      ev.sequence = it->second->sequence;
+      if (it->second->body != ev.body)
+        {
+          ++ev.sequence;
+          ++d.changed;
+          if (delta)
+            delta->push_back (ev);
+        }
+      prev.erase (it);
+    }
+  for (size_t i = 0; i < previous.size (); ++i)
+    if (prev.count (previous[i].uid))
+      {
+        ++d.cancelled;
+        if (cancelled)
+          {
+            IcsEvent ev = previous[i];
+            ++ev.sequence;
+            cancelled->push_back (ev);
+          }
+      }
+  return d;
+}
+
+// 环境变量 SOURCE_DATE_EPOCH 给出的时刻
+bool
+sourceDateEpoch (long long &when)
+{
+  const char *env = getenv ("SOURCE_DATE_EPOCH");
+  if (!env || !*env)
+    return false;
+  when = atoll (env);
+  return true;
+}
+
+// 没有输入文件时（管道、常驻模式）的 DTSTAMP：当前 UTC 时间；设置了
+// SOURCE_DATE_EPOCH 时使用该时间，便于得到可复现的输出
+string
+icsTimestamp ()
+{
+  long long now = (long long)time (NULL);
+  sourceDateEpoch (now);
+  return icsTimestamp (now);
+}
+
+// 由输入文件的修改时间得到的 DTSTAMP：页面没变时重新生成的日历逐字节
+// 相同，订阅者按 ETag 验证也会命中。设置了 SOURCE_DATE_EPOCH 时不晚于
+// 该时间
+string
+inputTimestamp (long long mtime)
+{
+  long long epoch;
+  if (sourceDateEpoch (epoch) && epoch < mtime)
+    mtime = epoch;
+  return icsTimestamp (mtime);
+}
+
+// 指定时刻（Unix 秒）的 DTSTAMP
+string
+icsTimestamp (long long when)
+{
+  long long days = when / 86400, secs = when % 86400;
+  if (secs < 0)
+    {
+      secs += 86400;
+      --days;
+    }
+  long long y;
+  int m, d;
+  civilFromDays (days, y, m, d);
+  char buf[32];
+  snprintf (buf, sizeof buf, "%04lld%02d%02dT%02d%02d%02dZ", y, m, d,
+            (int)(secs / 3600), (int)(secs / 60 % 60), (int)(secs % 60));
+  return buf;
+}
+
+// 写出 ICS 日历，cancelled 中的事件带 STATUS:CANCELLED
+void
+writeIcsCalendar (ostream &ics, const vector<IcsEvent> &events,
+                  const vector<IcsEvent> &cancelled, const string &stamp)
+{
+  ics << "BEGIN:VCALENDAR\nVERSION:2.0\nPRODID:-//NEU Course Table//CN\n";
+  for (int pass = 0; pass < 2; ++pass)
+    {
+      const vector<IcsEvent> &list = pass ? cancelled : events;
+      for (size_t i = 0; i < list.size (); ++i)
+        {
+          ics << "BEGIN:VEVENT\n";
+          ics << "UID:" << list[i].uid << "\n";
+          ics << "DTSTAMP:" << stamp << "\n";
+          ics << "SEQUENCE:" << list[i].sequence << "\n";
+          if (pass)
+            ics << "STATUS:CANCELLED\n";
+          ics << list[i].body;
+          ics << "END:VEVENT\n";
+        }
+    }
+  ics << "END:VCALENDAR\n";
+}
+
+// 写出一份全新的 ICS 日历，返回其中的上课次数
+int
+writeIcs (ostream &ics, const vector<Course> &courses,
+          const string &startSunday, bool expanded)
+{
+  vector<IcsEvent> events;
+  int totalEvents = buildIcsEvents (courses, startSunday, expanded, events);
+  writeIcsCalendar (ics, events, vector<IcsEvent> (), icsTimestamp ());
+  return totalEvents;
+}
+
+// 一门课的 CSV 记录，连续的周数合并为一条
+void
+appendCsvRows (const Course &c, string &out)
+{
+  if (!c.weeks)
+    return;
+
+  // 转换星期：0(周日)->7, 1(周一)->1 ... 6(周六)->6
+  int displayDay = (c.day == 0) ? 7 : c.day;
+  static const char NONE[] = "无";
+  const char *teacher = c.description.empty () ? NONE : c.description.data ();
+  size_t teacherLen = c.description.empty () ? sizeof (NONE) - 1
+                                               : c.description.size ();
+  const char *location = c.location.empty () ? NONE : c.location.data ();
+  size_t locationLen
+      = c.location.empty () ? sizeof (NONE) - 1 : c.location.size ();
+  char num[32];
+  int numLen = snprintf (num, sizeof num, ",%d,%d,%d,", displayDay,
+                         c.startPeriod, c.endPeriod);
+
+  // 用位扫描查找连续的周数段，每段生成一条记录
+  for (WeekMask m = c.weeks; m;)
+    {
+      int startW = lowestWeek (m);
+      WeekMask gaps = ~(m >> (startW - 1)); // 从 startW 起第一个空位
+      int prevW = gaps ? startW + lowestWeek (gaps) - 2 : MAX_WEEKS;
+      m &= ~weekRange (startW, prevW);
+
+      char range[32];
+      int rangeLen = startW == prevW
+                         ? snprintf (range, sizeof range, "%d周", startW)
+                         : snprintf (range, sizeof range, "%d-%d周", startW,
+                                     prevW);
+
+      csvQuote (c.title.data (), c.title.size (), out);
+      out.append (num, numLen);
+      csvQuote (teacher, teacherLen, out);
+      out += ',';
+      csvQuote (location, locationLen, out);
+      out += ',';
+      csvQuote (range, rangeLen, out);
+      out += '\n';
+    }
+}
+
+const char CSV_HEADER[] = "课程名称,星期,开始节数,结束节数,老师,地点,周数\n";
+
+// 写出 CSV 课程表
+void
+writeCsv (ostream &csv, const vector<Course> &courses)
+{
+  csv << CSV_HEADER;
+  string rows;
+  for (const auto &c : courses)
+    {
+      rows.clear ();
+      appendCsvRows (c, rows);
+      csv << rows;
+    }
+}
+
+void
+writeCsv (ostream &csv, const vector<const Section *> &sections)
+{
+  csv << CSV_HEADER;
+  for (size_t i = 0; i < sections.size (); ++i)
+    csv << sections[i]->csvRows;
+}
+
+// 一门课在旧版 HTML 单元格中的一项：title 属性中的文字（已转义）和
+// 单元格中的内容
+void
+renderHtmlItem (const Course &c, string &title, string &box)
+{
+  // 括号和分隔符中没有需要转义的字符，只转义四个字段
+  title.clear ();
+  escapeHtml (c.title.data (), c.title.size (), title);
+  title += " (";
+  escapeHtml (c.description.data (), c.description.size (), title);
+  title += "); (";
+  escapeHtml (c.weekStr.data (), c.weekStr.size (), title);
+  title += ", ";
+  escapeHtml (c.location.data (), c.location.size (), title);
+  title += ')';
+
+  box.clear ();
+  box.append (c.title.data (), c.title.size ());
+  box += "<br>(";
+  box.append (c.description.data (), c.description.size ());
+  box += ")<br>(";
+  box.append (c.weekStr.data (), c.weekStr.size ());
+  box += ", ";
+  box.append (c.location.data (), c.location.size ());
+  box += ')';
+}
+
+// 生成旧版教务系统样式的 HTML 课表。titles[i] 与 boxes[i] 为
+// courses[i] 由 renderHtmlItem 得到的两项
+string
+renderOldHtmlGrid (const vector<const Course *> &courses,
+                   const vector<const string *> &titles,
+                   const vector<const string *> &boxes,
+                   const string &semesterInfo)
+{
+  string h_header = R"(<!DOCTYPE html>
+<html>
+<head>
+    <meta http-equiv="content-type" content="text/html; charset=utf-8">
+    <meta http-equiv="X-UA-Compatible" content="IE=edge">
+    <title>我的课表 (旧系统还原)</title>
+    <link href="/eams/static/themes/default/css/semesterCalendar.css" rel="stylesheet" type="text/css">
+    <link href="/eams/static/scripts/font-awesome/css/font-awesome.min.css" rel="stylesheet" type="text/css">
+    <link href="/eams/static/themes/default/css/jquery-ui.css" rel="stylesheet" type="text/css">
+    <link href="/eams/static/themes/default/css/global.css" rel="stylesheet" type="text/css">
+    <style>
+        .gridtable { border-collapse: collapse; width: 100%; border: 1px solid #000; background: white; table-layout: fixed; text-align: center; border-spacing: 0px;}
+        .gridtable th { background-color: #DEEDF7; border: 1px solid #000; font-size: 13px; font-weight: normal; height: 30px; }
+        .gridtable td { border: 1px solid #000; text-align: center; padding: 2px; font-size: 11px; vertical-align: middle; }
+        .infoTitle { background-color: rgb(148, 174, 243); cursor: pointer; color: black; }
+        .period-label { background-color: #DEEDF7; font-weight: normal; width: 80px; }
+        #main-top { height: 50px; background-color: #2b70c1; color: white; display: flex; align-items: center; justify-content: space-between; padding: 0 20px; }
+        #main-top .logo img { height: 35px; }
+        .system-name { font-size: 18px; font-weight: bold; margin-left: 10px; }
+        .personal-list ul { list-style: none; display: flex; margin: 0; padding: 0; }
+        .personal-list li { margin-left: 20px; font-size: 14px; }
+        .personal-list a { color: white; text-decoration: none; }
+        .main-nav { background-color: #f1f1f1; border-bottom: 2px solid #2b70c1; padding: 5px 20px; }
+        .main-nav ul { list-style: none; display: flex; margin: 0; padding: 0; }
+        .main-nav li { margin-right: 20px; padding: 5px 10px; }
+        .main-nav li.active { background-color: #2b70c1; }
+        .main-nav li.active a { color: white; }
+        .main-nav a { text-decoration: none; color: #333; font-weight: bold; }
+        #menu_panel { background-color: #f9f9f9; border-right: 1px solid #ddd; height: 100%; }
+        .menu { list-style: none; padding: 0; margin: 0; }
+        .first_menu { display: block; padding: 10px; background: #e9e9e9; border-bottom: 1px solid #ddd; color: #333; text-decoration: none; font-weight: bold; }
+        .acitem { list-style: none; padding: 0; margin: 0; }
+        .acitem li { padding: 5px 20px; border-bottom: 1px split #eee; }
+        .acitem li.current { background-color: #d9e8fb; border-left: 4px solid #2b70c1; }
+        .acitem a { text-decoration: none; color: #666; font-size: 13px; }
+    </style>
+</head>
+<body class="main_body">
+    <div id="main-top">
+        <div style="display:flex; align-items:center;">
+            <div class="logo"><img src="/eams/static/images/logo.png"></div>
+            <div class="system-name">教务管理系统</div>
+        </div>
+        <div class="personal-list">
+            <ul>
+                <li><a href="#"><span class="fa fa-user"></span> 学生用户</a></li>
+                <li><a href="#"><span class="fa fa-question-circle"></span> 帮助</a></li>
+                <li><a href="#"><span class="fa fa-sign-out"></span> 退出</a></li>
+            </ul>
+        </div>
+    </div>
+    <div class="main-nav">
+        <ul>
+            <li class="active"><a href="#"><span class="fa fa-home"></span> 首页</a></li>
+            <li><a href="#">可用资源查询</a></li>
+            <li><a href="#">公共课表查询</a></li>
+        </ul>
+    </div>
+
+    <table style="width:100%; height: calc(100vh - 100px); border-collapse: collapse;">
+        <tr>
+            <td valign="top" style="width: 200px; background: #f9f9f9; border-right: 1px solid #ccc;">
+                <div id="menu_panel">
+                    <ul class="menu">
+                        <li>
+                            <a class="first_menu" href="#"><span class="fa fa-dashboard"></span> 我的</a>
+                            <ul class="acitem">
+                                <li><a href="#">学籍信息</a></li>
+                                <li><a href="#">培养计划</a></li>
+                                <li class="current"><a href="#">我的课表</a></li>
+                                <li><a href="#">选课</a></li>
+                                <li><a href="#">我的考试</a></li>
+                                <li><a href="#">我的成绩</a></li>
+                            </ul>
+                        </li>
+                    </ul>
+                </div>
+            </td>
+            <td valign="top" style="padding: 10px;">
+                <div id="main">
+                    <div class="toolbar">
+                        <div class="toolbar-title"><span class="fa fa-calendar"></span> <strong>我的课表</strong></div>
+                        <div class="toolbar-line"><hr color="#AED0EA"></div>
+                    </div>
+                    
+                    <div style="background: #DEEDF7; border: 1px solid #AED0EA; padding: 5px; margin-bottom: 10px; font-weight: bold;">
+                        课表类型: 学生课表 | 
+                        选择教学周: 全部 | 
+                        学年学期: )";
+
+  string h_middle = R"(
+                        <button style="float:right;">切换学期</button>
+                    </div>
+
+                    <div align="center">
+                        <pre style="font-size: 12px; color: #666; margin: 5px;">课表格式说明：教师姓名 课程名称(序号) (第n周-第m周,教室)</pre>
+                        <table id="manualArrangeCourseTable" class="gridtable" border="1">
+                            <caption>学生课表说明</caption>
+                            <thead>
+                                <tr>
+                                    <th style="width:80px;">节次/周次</th>
+                                    <th id="day1">星期日</th>
+                                    <th id="day2">星期一</th>
+                                    <th id="day3">星期二</th>
+                                    <th id="day4">星期三</th>
+                                    <th id="day5">星期四</th>
+                                    <th id="day6">星期五</th>
+                                    <th id="day7">星期六</th>
+                                </tr>
+                            </thead>
+                            <tbody>)";
+
+  stringstream t_body;
+  vector<size_t> cgrid[13][7]; // courses 中的下标
+  for (size_t i = 0; i < courses.size (); ++i)
+    {
+      const Course &c = *courses[i];
+      if (c.day >= 0 && c.day < 7 && c.startPeriod >= 1 && c.startPeriod <= 12)
+        cgrid[c.startPeriod][c.day].push_back (i);
+    }
+
+  bool occupied[13][7] = { false };
+  const char *pNames[]
+      = { "",        " 第一节",   " 第二节",  " 第三节", " 第四节",
+          " 第五节", " 第六节",   " 第七节",  " 第八节", " 第九节",
+          " 第十节", " 第十一节", " 第十二节" };
+
+  for (int p = 1; p <= 12; ++p)
+    {
+      t_body << "<tr>";
+      t_body << "<td class='period-label'>" << pNames[p] << "</td>";
+
+      for (int d = 0; d < 7; ++d)
+        {
+          if (occupied[p][d])
+            continue;
+
+          if (cgrid[p][d].empty ())
+            {
+              t_body << "<td style='background-color: #ffffff;'></td>";
+              continue;
+            }
+
+          int mEnd = p;
+          for (size_t i : cgrid[p][d])
+            {
+              if (courses[i]->endPeriod > mEnd)
+                mEnd = courses[i]->endPeriod;
+            }
+          if (mEnd > 12)
+            mEnd = 12;
+
+          int rowspan = mEnd - p + 1;
+
+          t_body << "<td class='infoTitle' rowspan='" << rowspan
+                 << "' title='";
+          for (size_t i = 0; i < cgrid[p][d].size (); ++i)
+            {
+              if (i > 0)
+                t_body << "; ";
+              t_body << *titles[cgrid[p][d][i]];
+            }
+          t_body << "'>";
+          t_body << "<div class='course-box'>";
+
+          for (size_t i = 0; i < cgrid[p][d].size (); ++i)
+            {
+              t_body << *boxes[cgrid[p][d][i]];
+              if (i < cgrid[p][d].size () - 1)
+                t_body << "<br>---<br>";
+            }
+
+          t_body << "</div></td>";
+
+          for (int r = p; r <= mEnd; ++r)
+            occupied[r][d] = true;
+        }
+      t_body << "</tr>";
+    }
+
+  string h_footer = R"(                            </tbody>
+                        </table>
+                    </div>
+                </div>
+            </td>
+        </tr>
+    </table>
+</body>
+</html>)";
+
+  string final_html
+      = h_header + semesterInfo + h_middle + t_body.str () + h_footer;
+  return final_html;
+}
+
+string
+renderOldHtml (const vector<Course> &courses, const string &semesterInfo)
+{
+  vector<const Course *> ptrs (courses.size ());
+  vector<string> titles (courses.size ()), boxes (courses.size ());
+  vector<const string *> titlePtrs (courses.size ()),
+      boxPtrs (courses.size ());
+  for (size_t i = 0; i < courses.size (); ++i)
+    {
+      renderHtmlItem (courses[i], titles[i], boxes[i]);
+      ptrs[i] = &courses[i];
+      titlePtrs[i] = &titles[i];
+      boxPtrs[i] = &boxes[i];
+    }
+  return renderOldHtmlGrid (ptrs, titlePtrs, boxPtrs, semesterInfo);
+}
+
+string
+renderOldHtml (const vector<const Section *> &sections,
+               const string &semesterInfo)
+{
+  vector<const Course *> ptrs (sections.size ());
+  vector<const string *> titles (sections.size ()), boxes (sections.size ());
+  for (size_t i = 0; i < sections.size (); ++i)
+    {
+      ptrs[i] = &sections[i]->course;
+      titles[i] = &sections[i]->htmlTitle;
+      boxes[i] = &sections[i]->htmlBox;
+    }
+  return renderOldHtmlGrid (ptrs, titles, boxes, semesterInfo);
+}
+
+// ---- 教学班表 ----
+
+SectionTable::SectionTable (const string &startSunday, bool expandedIcs,
+                            size_t capacity)
+    : startSunday_ (startSunday), calendar_ (startSunday),
+      expanded_ (expandedIcs), capacity_ (capacity), size_ (0)
+{
+}
+
+// 与课程的全部字段对应的键
+string
+sectionKey (const Course &c)
+{
+  string key;
+  key.reserve (c.title.size () + c.location.size () + c.description.size ()
+               + c.weekStr.size () + 48);
+  key.append (c.title.data (), c.title.size ());
+  key += '\x1f';
+  key.append (c.location.data (), c.location.size ());
+  key += '\x1f';
+  key.append (c.description.data (), c.description.size ());
+  key += '\x1f';
+  key.append (c.weekStr.data (), c.weekStr.size ());
+  key += '\x1f';
+  char buf[48];
+  snprintf (buf, sizeof buf, "%d\x1f%d\x1f%d\x1f%llx", c.day, c.startPeriod,
+            c.endPeriod, (unsigned long long)c.weeks);
+  key += buf;
+  return key;
+}
+
+const Section *
+SectionTable::intern (const Course &c)
+{
+  string key = sectionKey (c);
+  Shard &shard = shards_[fnv1a (key) % SHARDS];
+  {
+    lock_guard<mutex> guard (shard.lock);
+    unordered_map<string, unique_ptr<Section> >::iterator it
+        = shard.sections.find (key);
+    if (it != shard.sections.end ())
+      return it->second.get ();
+  }
+  if (size_.load () >= capacity_)
+    return NULL;
+
+  // 在锁外生成片段，两个线程同时遇到同一教学班时留下先插入的一份
+  unique_ptr<Section> sec (new Section);
+  render (c, *sec);
+
+  lock_guard<mutex> guard (shard.lock);
+  unique_ptr<Section> &slot = shard.sections[key];
+  if (!slot)
+    {
+      slot.swap (sec);
+      ++size_;
+    }
+  return slot.get ();
+}
+
+// 生成 c 的各片段，sec.course 的字段驻留在表自己的池中
+void
+SectionTable::render (const Course &c, Section &sec)
+{
+  ostringstream body;
+  sec.course = c;
+  {
+    lock_guard<mutex> guard (stringsLock_);
+    internCourse (strings_, sec.course);
+  }
+  sec.classes = renderCourseEvents (c, calendar_, expanded_, body,
+                                    sec.events);
+  appendCsvRows (c, sec.csvRows);
+  renderHtmlItem (c, sec.htmlTitle, sec.htmlBox);
+}
+
+size_t
+SectionTable::size () const
+{
+  return size_.load ();
+}
+
+// ---- 文件与目录辅助函数 ----
+
+MappedFile::MappedFile ()
+{
+  data_ = NULL;
+  size_ = 0;
+#ifdef _WIN32
+  mapping_ = NULL;
+#endif
+}
+
+bool
+MappedFile::open (const string &path)
+{
+  close ();
+#ifdef _WIN32
+  HANDLE file = CreateFileA (path.c_str (), GENERIC_READ, FILE_SHARE_READ,
+                             NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                             NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER len;
+  if (!GetFileSizeEx (file, &len))
+    {
+      CloseHandle (file);
+      return false;
+    }
+  size_ = (size_t)len.QuadPart;
+  if (size_ > 0)
+    {
+      mapping_ = CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (mapping_)
+        data_ = (const char *)MapViewOfFile (mapping_, FILE_MAP_READ, 0, 0,
+                                             0);
+    }
+  CloseHandle (file);
+  if (size_ > 0 && !data_)
+    {
+      close ();
+      return false;
+    }
+#else
+  int fd = ::open (path.c_str (), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+    {
+      ::close (fd);
+      return false;
+    }
+  size_ = (size_t)st.st_size;
+  if (size_ > 0)
+    {
+      void *p = mmap (NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+        {
+          data_ = (const char *)p;
+          madvise (p, size_, MADV_SEQUENTIAL);
+        }
+    }
+  ::close (fd);
+  if (size_ > 0 && !data_)
+    {
+      size_ = 0;
+      return false;
+    }
+#endif
+  return true;
+}
+
+void
+MappedFile::close ()
+{
+#ifdef _WIN32
+  if (data_)
+    UnmapViewOfFile (data_);
+  if (mapping_)
+    CloseHandle (mapping_);
+  mapping_ = NULL;
+#else
+  if (data_)
+    munmap ((void *)data_, size_);
+#endif
+  data_ = NULL;
+  size_ = 0;
+}
+
+bool
+isDirectory (const string &path)
+{
+  struct stat st;
+  return stat (path.c_str (), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+bool
+isRegularFile (const string &path)
+{
+  struct stat st;
+  return stat (path.c_str (), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+}
+
+string
+joinPath (const string &dir, const string &name)
+{
+  if (dir.empty ())
+    return name;
+  char last = dir[dir.size () - 1];
+  if (last == '/' || last == '\\')
+    return dir + name;
+  return dir + "/" + name;
+}
+
+// 逐级创建目录，目录已存在视为成功
+bool
+makeDirs (const string &path)
+{
+  for (size_t i = 1; i <= path.size (); ++i)
+    {
+      if (i < path.size () && path[i] != '/' && path[i] != '\\')
+        continue;
+      string sub = path.substr (0, i);
+#ifdef _WIN32
+      _mkdir (sub.c_str ());
+#else
+      mkdir (sub.c_str (), 0755);
+#endif
+    }
+  return isDirectory (path);
+}
+
+// 列出目录下的全部条目名（不含 . 和 ..），按名称排序
+vector<string>
+listDirectory (const string &dir)
+{
+  vector<string> names;
+#ifdef _WIN32
+  WIN32_FIND_DATAA fd;
+  HANDLE h = FindFirstFileA (joinPath (dir, "*").c_str (), &fd);
+  if (h != INVALID_HANDLE_VALUE)
+    {
+      do
+        {
+          string name = fd.cFileName;
+          if (name != "." && name != "..")
+            names.push_back (name);
+        }
+      while (FindNextFileA (h, &fd));
+      FindClose (h);
+    }
+#else
+  DIR *d = opendir (dir.c_str ());
+  if (d)
+    {
+      while (struct dirent *ent = readdir (d))
+        {
+          string name = ent->d_name;
+          if (name != "." && name != "..")
+            names.push_back (name);
+        }
+      closedir (d);
+    }
+#endif
+  sort (names.begin (), names.end ());
+  return names;
+}
+
+string
+tempPath (const string &path)
+{
+  return path + ".tmp";
+}
+
+// 同一目录内改名是原子的；失败时删除临时文件
+bool
+replaceFile (const string &tmp, const string &path)
+{
+#ifdef _WIN32
+  bool ok = MoveFileExA (tmp.c_str (), path.c_str (),
+                         MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  bool ok = rename (tmp.c_str (), path.c_str ()) == 0;
+#endif
+  if (!ok)
+    remove (tmp.c_str ());
+  return ok;
+}
+
+bool
+hasSuffix (const string &s, const string &suffix)
+{
+  return s.size () >= suffix.size ()
+         && s.compare (s.size () - suffix.size (), suffix.size (), suffix)
+                == 0;
+}
+
+// ---- 解析结果缓存 ----
+// 解析出的课表以二进制形式存在输出目录的 schedule.cache 中，以输入的
+// 大小、修改时间和内容散列为键。只改起始日期或输出格式时不必重新解析，
+// 批量模式下输入与输出参数都没变的学生直接跳过。
+
+static const char CACHE_MAGIC[8] = { 'N', 'C', 'T', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t CACHE_VERSION = 1; // 解析逻辑或 Course 字段变化时加一
+
+// 输入内容的快速散列，每次处理 8 字节
+uint64_t
+hashBytes (const char *p, size_t n)
+{
+  const uint64_t K = 0x9E3779B97F4A7C15ULL;
+  uint64_t h = (uint64_t)n * K;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+    {
+      uint64_t w;
+      memcpy (&w, p + i, 8);
+      h = (h ^ w) * K;
+      h ^= h >> 29;
+    }
+  uint64_t w = 0;
+  if (i < n) // 空文件映射出的 p 为 NULL
+    memcpy (&w, p + i, n - i);
+  h = (h ^ w) * K;
+  return h ^ (h >> 32);
+}
+
+// 文件大小与修改时间（秒）
+bool
+statFile (const string &path, uint64_t &size, long long &mtime)
+{
+  struct stat st;
+  if (stat (path.c_str (), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG)
+    return false;
+  size = (uint64_t)st.st_size;
+  mtime = (long long)st.st_mtime;
+  return true;
+}
+
+void
+putU32 (string &out, uint32_t v)
+{
+  out.append ((const char *)&v, sizeof v);
+}
+
+void
+putU64 (string &out, uint64_t v)
+{
+  out.append ((const char *)&v, sizeof v);
+}
+
+void
+putString (string &out, const string &s)
+{
+  putU32 (out, (uint32_t)s.size ());
+  out += s;
+}
+
+void
+putString (string &out, const Text &s)
+{
+  putU32 (out, (uint32_t)s.size ());
+  out.append (s.data (), s.size ());
+}
+
+// 按写入顺序读回缓存字段，越界即失败
+class CacheReader
+{
+public:
+  CacheReader (const string &buf) : p_ (buf.data ()), end_ (p_ + buf.size ())
+  {
+  }
+
+  bool
+  raw (void *out, size_t n)
+  {
+    if ((size_t)(end_ - p_) < n)
+      return false;
+    memcpy (out, p_, n);
+    p_ += n;
+    return true;
+  }
+
+  bool
+  u32 (uint32_t &v)
+  {
+    return raw (&v, sizeof v);
+  }
+
+  bool
+  u64 (uint64_t &v)
+  {
+    return raw (&v, sizeof v);
+  }
+
+  bool
+  str (string &s)
+  {
+    uint32_t n;
+    if (!u32 (n) || (size_t)(end_ - p_) < n)
+      return false;
+    s.assign (p_, n);
+    p_ += n;
+    return true;
+  }
+
+  // 读出一个字符串并驻留到 strings 中
+  bool
+  str (StringPool &strings, Text &s)
+  {
+    uint32_t n;
+    if (!u32 (n) || (size_t)(end_ - p_) < n)
+      return false;
+    s = strings.intern (p_, n);
+    p_ += n;
+    return true;
+  }
+
+  bool
+  atEnd () const
+  {
+    return p_ == end_;
+  }
+
+private:
+  const char *p_;
+  const char *end_;
+};
+
+// 读取缓存文件，文件不存在、版本不符或内容损坏都返回 false。
+// 字段按本机字节序存储，换到字节序不同的机器上会因版本号不符而失效
+bool
+readScheduleCache (const string &path, ScheduleCache &cache)
+{
+  ifstream in (path.c_str (), ios::binary);
+  if (!in)
+    return false;
+  string buf ((istreambuf_iterator<char> (in)), istreambuf_iterator<char> ());
+  CacheReader r (buf);
+  char magic[sizeof CACHE_MAGIC];
+  uint32_t version, count;
+  uint64_t mtime;
+  if (!r.raw (magic, sizeof magic)
+      || memcmp (magic, CACHE_MAGIC, sizeof magic) != 0 || !r.u32 (version)
+      || version != CACHE_VERSION || !r.u64 (cache.size) || !r.u64 (mtime)
+      || !r.u64 (cache.hash) || !r.str (cache.outputKey)
+      || !r.str (cache.sched.semesterInfo) || !r.u32 (count))
+    return false;
+  cache.mtime = (long long)mtime;
+  cache.sched.courses.clear ();
+  cache.sched.strings = make_shared<StringPool> ();
+  StringPool &strings = *cache.sched.strings;
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      Course c;
+      uint32_t day, startPeriod, endPeriod;
+      uint64_t weeks;
+      if (!r.str (strings, c.title) || !r.str (strings, c.location)
+          || !r.str (strings, c.description) || !r.str (strings, c.weekStr)
+          || !r.u32 (day) || !r.u32 (startPeriod)
+          || !r.u32 (endPeriod) || !r.u64 (weeks))
+        return false;
+      c.day = (int)day;
+      c.startPeriod = (int)startPeriod;
+      c.endPeriod = (int)endPeriod;
+      c.weeks = weeks;
+      cache.sched.courses.push_back (c);
+    }
+  return r.atEnd ();
+}
+
+bool
+writeScheduleCache (const string &path, const ScheduleCache &cache,
+                    RunStats *stats)
+{
+  StageTimer timer (stats, STAGE_CACHE);
+  string out (CACHE_MAGIC, sizeof CACHE_MAGIC);
+  putU32 (out, CACHE_VERSION);
+  putU64 (out, cache.size);
+  putU64 (out, (uint64_t)cache.mtime);
+  putU64 (out, cache.hash);
+  putString (out, cache.outputKey);
+  putString (out, cache.sched.semesterInfo);
+  putU32 (out, (uint32_t)cache.sched.courses.size ());
+  for (const auto &c : cache.sched.courses)
+    {
+      putString (out, c.title);
+      putString (out, c.location);
+      putString (out, c.description);
+      putString (out, c.weekStr);
+      putU32 (out, (uint32_t)c.day);
+      putU32 (out, (uint32_t)c.startPeriod);
+      putU32 (out, (uint32_t)c.endPeriod);
+      putU64 (out, c.weeks);
+    }
+  string tmp = tempPath (path);
+  ofstream f (tmp.c_str (), ios::binary);
+  f << out;
+  f.close ();
+  timer.stop (out.size ());
+  if (f.fail ())
+    {
+      remove (tmp.c_str ());
+      return false;
+    }
+  return replaceFile (tmp, path);
+}
+
+// 得到 input 的解析结果。cachePath 处的缓存与输入一致时直接取用，否则
+// 映射并解析输入。大小和修改时间都相同时连输入都不读；修改时间不同但
+// 内容散列相同时仍可命中。dirty 表示 cache 与磁盘上的缓存不同、需要
+// 写回；bytes 为实际读取的输入字节数
+bool
+loadSchedule (const string &input, const string &cachePath, bool useCache,
+              ScheduleCache &cache, bool &hit, bool &dirty, size_t &bytes,
+              string &err, RunStats *stats)
+{
+  StageTimer loadTimer (stats, STAGE_LOAD);
+  hit = false;
+  dirty = useCache;
+  bytes = 0;
+  uint64_t size;
+  long long mtime;
+  if (!statFile (input, size, mtime))
+    {
+      err = "无法打开 " + input;
+      return false;
+    }
+  cache.inputMtime = mtime;
+  // 与当前时间同一秒内的修改时间不可信：同一秒内再次改写不会改变它
+  if (mtime >= (long long)time (NULL))
+    mtime = UNKNOWN_MTIME;
+
+  bool haveOld = useCache && readScheduleCache (cachePath, cache)
+                 && cache.size == size;
+  if (haveOld && mtime != UNKNOWN_MTIME && cache.mtime == mtime)
+    {
+      hit = true;
+      dirty = false;
+      return true;
+    }
+
+  MappedFile in;
+  if (!in.open (input))
+    {
+      err = "无法打开 " + input;
+      return false;
+    }
+  bytes = in.size ();
+  uint64_t h = hashBytes (in.data (), in.size ());
+  loadTimer.stop (in.size ());
+  if (haveOld && cache.hash == h)
+    hit = true;
+  else
+    {
+      cache.sched = parseSchedule (in.data (), in.size (), stats);
+      cache.outputKey.clear ();
+      cache.hash = h;
+    }
+  cache.size = in.size ();
+  cache.mtime = mtime;
+  return true;
+}
+
+// ---- 输出文件 ----
+
+string
+OutputOptions::outputKey (const string &startSunday) const
+{
+  return startSunday + (expandedIcs ? "\x1f" "expand" : "");
+}
+
+// 输出流已写入的字节数，流不支持定位时为 0
+unsigned long long
+streamBytes (ostream &out)
+{
+  streamoff pos = out.tellp ();
+  return pos > 0 ? (unsigned long long)pos : 0;
+}
+
+// 把一份课表的全部输出文件写到 dir 目录下，sourceTime 为输入页面的修改
+// 时间，决定 ICS 的 DTSTAMP。stats 不为 NULL 时记录各输出的耗时与字节数。
+// sections 不为 NULL 且按相同参数生成片段时，从中取各教学班已生成的片段
+// 拼装输出
+bool
+writeOutputs (const string &dir, const Schedule &sched,
+              const string &startSunday, long long sourceTime,
+              const OutputOptions &opts, OutputSummary &summary, string &err,
+              RunStats *stats, SectionTable *sections)
+{
+  // 有课程未能放入已满的表时，整份课表改为逐门课生成
+  vector<const Section *> secs;
+  bool shared = sections && sections->renders (startSunday, opts.expandedIcs);
+  for (size_t i = 0; shared && i < sched.courses.size (); ++i)
+    {
+      secs.push_back (sections->intern (sched.courses[i]));
+      shared = secs.back () != NULL;
+    }
+
+  if (!makeDirs (joinPath (dir, "eams")))
+    {
+      err = "无法创建目录 " + joinPath (dir, "eams");
+      return false;
+    }
+
+  // 读回上一次的 schedule.ics，未变的事件沿用原 SEQUENCE
+  StageTimer icsTimer (stats, STAGE_ICS);
+  string icsPath = joinPath (dir, "schedule.ics");
+  vector<IcsEvent> events, previous, delta, cancelled;
+  summary.events = shared ? buildIcsEvents (secs, events)
+                          : buildIcsEvents (sched.courses, startSunday,
+                                            opts.expandedIcs, events);
+  {
+    ifstream prevIcs (icsPath.c_str ());
+    readIcsEvents (prevIcs, previous);
+  }
+  summary.delta = applyPrevious (events, previous,
+                                 opts.deltaIcs ? &delta : NULL,
+                                 opts.deltaIcs ? &cancelled : NULL);
+  string stamp = inputTimestamp (sourceTime);
+
+  // 各文件先写到临时文件，全部写成功后才逐个替换
+  vector<string> paths;
+  paths.push_back (icsPath);
+  if (opts.deltaIcs)
+    paths.push_back (joinPath (dir, "schedule-delta.ics"));
+  paths.push_back (joinPath (dir, "courses.csv"));
+  paths.push_back (joinPath (dir, "exp_old.html"));
+  paths.push_back (joinPath (dir, "eams/courseTableForStd.action"));
+  // 新增：模拟 Wakeup/小艾等常用的数据接口请求，直接返回完整 HTML
+  paths.push_back (
+      joinPath (dir, "eams/courseTableForStd!courseTable.action"));
+  bool ok = true;
+  size_t next = 0;
+
+  ofstream ics (tempPath (paths[next++]).c_str ()); // 创建输出文件
+  writeIcsCalendar (ics, events, vector<IcsEvent> (), stamp);
+  unsigned long long icsBytes = streamBytes (ics);
+  ics.close (); // 关闭文件
+  ok = ok && !ics.fail ();
+  if (opts.deltaIcs)
+    {
+      ofstream deltaIcs (tempPath (paths[next++]).c_str ());
+      writeIcsCalendar (deltaIcs, delta, cancelled, stamp);
+      icsBytes += streamBytes (deltaIcs);
+      deltaIcs.close ();
+      ok = ok && !deltaIcs.fail ();
+    }
+
+  icsTimer.stop (icsBytes);
+
+  StageTimer csvTimer (stats, STAGE_CSV);
+  ofstream csv (tempPath (paths[next++]).c_str ()); // 生成 CSV 课程表
+  if (shared)
+    writeCsv (csv, secs);
+  else
+    writeCsv (csv, sched.courses);
+  csvTimer.stop (streamBytes (csv));
+  csv.close ();
+  ok = ok && !csv.fail ();
+
+  // 生成旧版样式的 HTML 课表 (同步生成本地预览和 EAMS 模拟路径)
+  StageTimer htmlTimer (stats, STAGE_HTML);
+  string final_html = shared ? renderOldHtml (secs, sched.semesterInfo)
+                             : renderOldHtml (sched.courses,
+                                              sched.semesterInfo);
+  for (; next < paths.size (); ++next)
+    {
+      ofstream html (tempPath (paths[next]).c_str ());
+      html << final_html;
+      html.close ();
+      ok = ok && !html.fail ();
+    }
+  htmlTimer.stop (final_html.size () * 3);
+
+  for (size_t i = 0; i < paths.size (); ++i)
+    if (ok)
+      ok = replaceFile (tempPath (paths[i]), paths[i]);
+    else
+      remove (tempPath (paths[i]).c_str ());
+  if (!ok)
+    {
+      err = "写入输出文件失败: " + dir;
+      return false;
+    }
+  return true;
+}
+
+// ---- 多页面任务 ----
+
+// 从输入目录或清单文件收集任务。
+// 目录：其中的每个 *.html 文件（子目录名取文件名去掉扩展名），以及每个
+// 含有 exp.html 的子目录（子目录名不变）。
+// 清单：每行一个 HTML 路径，可用制表符隔开再给出输出子目录名；
+// 空行和 # 开头的行被忽略。
+bool
+collectJobs (const string &source, vector<BatchJob> &jobs, string &err)
+{
+  if (isDirectory (source))
+    {
+      vector<string> names = listDirectory (source);
+      for (size_t i = 0; i < names.size (); ++i)
+        {
+          string path = joinPath (source, names[i]);
+          BatchJob job;
+          if (isDirectory (path))
+            {
+              job.input = joinPath (path, "exp.html");
+              if (!isRegularFile (job.input))
+                continue;
+              job.name = names[i];
+            }
+          else if (hasSuffix (names[i], ".html"))
+            {
+              job.input = path;
+              job.name = names[i].substr (0, names[i].size () - 5);
+            }
+          else
+            continue;
+          jobs.push_back (job);
+        }
+      return true;
+    }
+
+  ifstream manifest (source.c_str ());
+  if (!manifest.is_open ())
+    {
+      err = "无法打开输入目录或清单文件 " + source;
+      return false;
+    }
+  string line;
+  while (getline (manifest, line))
+    {
+      const char *begin = line.data (), *end = begin + line.size ();
+      trim (begin, end);
+      line.erase (end - line.data ());
+      line.erase (0, begin - line.data ());
+      if (line.empty () || line[0] == '#')
+        continue;
+      BatchJob job;
+      size_t tab = line.find ('\t');
+      if (tab != string::npos)
+        {
+          begin = line.data ();
+          end = begin + tab;
+          trim (begin, end);
+          job.input.assign (begin, end);
+          begin = line.data () + tab + 1;
+          end = line.data () + line.size ();
+          trim (begin, end);
+          job.name.assign (begin, end);
+        }
+      else
+        {
+          job.input = line;
+          size_t slash = line.find_last_of ("/\\");
+          string file
+              = (slash == string::npos) ? line : line.substr (slash + 1);
+          if (file == "exp.html" && slash != string::npos)
+            {
+              // .../学号/exp.html 取所在目录名
+              string parent = line.substr (0, slash);
+              size_t pslash = parent.find_last_of ("/\\");
+              job.name = (pslash == string::npos) ? parent
+                                                  : parent.substr (pslash + 1);
+            }
+          else
+            {
+              size_t dot = file.rfind ('.');
+              job.name = (dot == string::npos) ? file : file.substr (0, dot);
+            }
+        }
+      jobs.push_back (job);
+    }
+  return true;
+}
+
+// 工作窃取调度：任务按轮转预先分给各线程的双端队列，线程从自己队列的
+// 尾部取任务，空了就从其他线程队列的头部窃取。任务不会在运行中新增，
+// 因此所有队列都取空时线程即可退出。线程数不超过任务数。
+void
+runWorkStealing (size_t jobCount, unsigned threads,
+                 const function<void (size_t)> &work)
+{
+  struct WorkQueue
+  {
+    mutex lock;
+    deque<size_t> jobs;
+  };
+  threads = (unsigned)min<size_t> (threads, max<size_t> (jobCount, 1));
+  if (threads == 0)
+    threads = 1;
+  vector<WorkQueue> queues (threads);
+  for (size_t i = 0; i < jobCount; ++i)
+    queues[i % threads].jobs.push_back (i);
+
+  auto worker = [&] (unsigned self) {
+    while (true)
+      {
+        size_t job = 0;
+        bool got = false;
+        {
+          lock_guard<mutex> guard (queues[self].lock);
+          if (!queues[self].jobs.empty ())
+            {
+              job = queues[self].jobs.back ();
+              queues[self].jobs.pop_back ();
+              got = true;
+            }
+        }
+        for (unsigned k = 1; !got && k < threads; ++k)
+          {
+            WorkQueue &victim = queues[(self + k) % threads];
+            lock_guard<mutex> guard (victim.lock);
+            if (!victim.jobs.empty ())
+              {
+                job = victim.jobs.front ();
+                victim.jobs.pop_front ();
+                got = true;
+              }
+          }
+        if (!got)
+          return;
+        work (job);
+      }
+  };
+
+  vector<thread> pool;
+  for (unsigned t = 1; t < threads; ++t)
+    pool.push_back (thread (worker, t));
+  worker (0);
+  for (size_t t = 0; t < pool.size (); ++t)
+    pool[t].join ();
+}
+
+// 载入目录或清单中的全部课表：含 schedule.cache 的子目录（批量模式的
+// 输出）直接读取缓存，其余按批量模式的规则找出页面并解析。loaded[i]
+// 为 false 表示 jobs[i] 无法载入
+bool
+loadScheduleSet (const string &source, unsigned threads,
+                 vector<BatchJob> &jobs, vector<Schedule> &scheds,
+                 vector<bool> &loaded, string &err)
+{
+  jobs.clear ();
+  vector<bool> fromCache;
+  if (isDirectory (source))
+    {
+      vector<string> names = listDirectory (source);
+      for (size_t i = 0; i < names.size (); ++i)
+        {
+          string cachePath
+              = joinPath (joinPath (source, names[i]), "schedule.cache");
+          if (isRegularFile (cachePath))
+            {
+              BatchJob job = { cachePath, names[i] };
+              jobs.push_back (job);
+              fromCache.push_back (true);
+            }
+        }
+    }
+  vector<BatchJob> pages;
+  string collectErr;
+  if (collectJobs (source, pages, collectErr))
+    for (size_t i = 0; i < pages.size (); ++i)
+      {
+        jobs.push_back (pages[i]);
+        fromCache.push_back (false);
+      }
+  if (jobs.empty ())
+    {
+      err = collectErr.empty () ? source + " 中没有可载入的课表" : collectErr;
+      return false;
+    }
+
+  scheds.assign (jobs.size (), Schedule ());
+  loaded.assign (jobs.size (), false);
+  vector<char> ok (jobs.size (), 0); // vector<bool> 不能由多个线程同时写
+  // 各学生的课程字段载入后改为驻留到同一个池中，全体学生共有的课程名、
+  // 教室和教师名只保存一份
+  shared_ptr<StringPool> strings = make_shared<StringPool> ();
+  mutex stringsLock;
+  runWorkStealing (jobs.size (), threads, [&] (size_t i) {
+    if (fromCache[i])
+      {
+        ScheduleCache cache;
+        if (readScheduleCache (jobs[i].input, cache))
+          {
+            swap (scheds[i], cache.sched);
+            ok[i] = 1;
+          }
+      }
+    else
+      {
+        MappedFile input;
+        if (input.open (jobs[i].input))
+          {
+            scheds[i] = parseSchedule (input.data (), input.size ());
+            ok[i] = 1;
+          }
+      }
+    if (ok[i])
+      {
+        lock_guard<mutex> guard (stringsLock);
+        for (size_t j = 0; j < scheds[i].courses.size (); ++j)
+          internCourse (*strings, scheds[i].courses[j]);
+        scheds[i].strings = strings;
+      }
+  });
+  for (size_t i = 0; i < jobs.size (); ++i)
+    loaded[i] = ok[i] != 0;
+  return true;
+}
+
+// ---- 空闲时间 ----
+
+void
+buildOccupancy (const vector<Course> &courses, Occupancy &occ)
+{
+  for (int i = 0; i < SLOT_COUNT; ++i)
+    occ.slots[i] = 0;
+  for (size_t i = 0; i < courses.size (); ++i)
+    {
+      const Course &c = courses[i];
+      if (c.day < 0 || c.day >= 7)
+        continue;
+      int first = max (c.startPeriod, 1);
+      int last = min (c.endPeriod, PERIODS_PER_DAY);
+      for (int p = first; p <= last; ++p)
+        occ.slots[slotIndex (c.day, p)] |= c.weeks;
+    }
+}
+
+void
+FreeTimeIndex::build (const vector<Occupancy> &students)
+{
+  students_ = students.size ();
+  words_ = (students_ + 63) / 64;
+  busy_.assign ((size_t)SLOT_COUNT * MAX_WEEKS * words_, 0);
+  for (size_t s = 0; s < students_; ++s)
+    {
+      uint64_t bit = 1ULL << (s % 64);
+      for (int slot = 0; slot < SLOT_COUNT; ++slot)
+        for (WeekMask m = students[s].slots[slot]; m; m &= m - 1)
+          {
+            size_t row = (size_t)slot * MAX_WEEKS + lowestWeek (m) - 1;
+            busy_[row * words_ + s / 64] |= bit;
+          }
+    }
+}
+
+// 一个格子里在 rows 的 weeks 行中都没有课、且在 mask 中的学生数。
+// rows 的每行有 stride 个字，只统计前 words 个字
+int
+countFreeScalar (const uint64_t *rows, size_t stride, int weeks,
+                 const uint64_t *mask, size_t words)
+{
+  int n = 0;
+  for (size_t w = 0; w < words; ++w)
+    {
+      uint64_t busy = 0;
+      for (int k = 0; k < weeks; ++k)
+        busy |= rows[k * stride + w];
+      n += weekCount (mask[w] & ~busy);
+    }
+  return n;
+}
+
+#ifdef NCT_SIMD_X86
+// 每次 4 个字：各周的行按位或，与选择的学生按位与非，再用半字节查表
+// 计数（AVX2 没有按字的 popcount），按字节求和累加到 4 个 64 位计数里
+NCT_TARGET ("avx2")
+int
+countFreeAvx2 (const uint64_t *rows, size_t stride, int weeks,
+               const uint64_t *mask, size_t words)
+{
+  const __m256i lut = _mm256_setr_epi8 (0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                        2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                        1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8 (0x0f);
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i total = zero;
+  size_t w = 0;
+  for (; w + 4 <= words; w += 4)
+    {
+      __m256i busy = zero;
+      for (int k = 0; k < weeks; ++k)
+        busy = _mm256_or_si256 (
+            busy, _mm256_loadu_si256 ((const __m256i *)(rows + k * stride
+                                                        + w)));
+      __m256i v = _mm256_andnot_si256 (
+          busy, _mm256_loadu_si256 ((const __m256i *)(mask + w)));
+      __m256i lo = _mm256_shuffle_epi8 (lut, _mm256_and_si256 (v, low));
+      __m256i hi = _mm256_shuffle_epi8 (
+          lut, _mm256_and_si256 (_mm256_srli_epi16 (v, 4), low));
+      total = _mm256_add_epi64 (
+          total, _mm256_sad_epu8 (_mm256_add_epi8 (lo, hi), zero));
+    }
+  uint64_t lanes[4];
+  _mm256_storeu_si256 ((__m256i *)lanes, total);
+  int n = (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+  return n + countFreeScalar (rows + w, stride, weeks, mask + w, words - w);
+}
+#endif
+
+typedef int (*CountFreeFn) (const uint64_t *, size_t, int, const uint64_t *,
+                            size_t);
+
+CountFreeFn
+pickCountFree ()
+{
+#ifdef NCT_SIMD_X86
+  if (cpuHasAvx2 ())
+    return countFreeAvx2;
+#endif
+  return countFreeScalar;
+}
+
+void
+FreeTimeIndex::countFree (int firstWeek, int lastWeek,
+                          const vector<uint64_t> *selection,
+                          int counts[SLOT_COUNT]) const
+{
+  static const CountFreeFn count = pickCountFree ();
+  firstWeek = max (firstWeek, 1);
+  lastWeek = min (lastWeek, MAX_WEEKS);
+  // 参与统计的学生，最后一个字中多出的位不算
+  vector<uint64_t> mask (words_, ~0ULL);
+  if (selection)
+    for (size_t w = 0; w < words_; ++w)
+      mask[w] = w < selection->size () ? (*selection)[w] : 0;
+  if (students_ % 64)
+    mask[words_ - 1] &= (1ULL << (students_ % 64)) - 1;
+
+  if (words_ == 0)
+    {
+      fill (counts, counts + SLOT_COUNT, 0);
+      return;
+    }
+  // 周数范围为空时谁都不占用，只数所选的学生
+  int weeks = max (lastWeek - firstWeek + 1, 0);
+  if (weeks == 0)
+    firstWeek = 1;
+  for (int slot = 0; slot < SLOT_COUNT; ++slot)
+    {
+      const uint64_t *rows
+          = &busy_[((size_t)slot * MAX_WEEKS + firstWeek - 1) * words_];
+      counts[slot] = count (rows, words_, weeks, &mask[0], words_);
+    }
+}
+
+void
+writeFreeJson (ostream &out, const int counts[SLOT_COUNT], int minFree,
+               size_t students, int firstWeek, int lastWeek,
+               const vector<string> &unknown)
+{
+  out << "{\"students\": " << students << ", \"weeks\": [" << firstWeek
+      << ", " << lastWeek << "], \"min\": " << minFree
+      << ", \"unknown\": [";
+  for (size_t i = 0; i < unknown.size (); ++i)
+    {
+      out << (i ? ", \"" : "\"");
+      for (size_t k = 0; k < unknown[i].size (); ++k)
+        {
+          char c = unknown[i][k];
+          if (c == '"' || c == '\\')
+            out << '\\';
+          if ((unsigned char)c >= 0x20)
+            out << c;
+        }
+      out << '"';
+    }
+  out << "],\n \"slots\": [";
+  bool first = true;
+  for (int slot = 0; slot < SLOT_COUNT; ++slot)
+    if (counts[slot] >= minFree)
+      {
+        out << (first ? "\n  " : ",\n  ") << "{\"day\": "
+            << slot / PERIODS_PER_DAY << ", \"period\": "
+            << slot % PERIODS_PER_DAY + 1 << ", \"free\": " << counts[slot]
+            << "}";
+        first = false;
+      }
+  out << "]}\n";
+}
+
+// ---- 教室占用 ----
+
+string
+roomName (const string &location)
+{
+  size_t pos = location.find ("浑南校区");
+  if (pos == string::npos)
+    pos = location.find ("南湖校区");
+  if (pos == string::npos)
+    return "";
+  // 按空白分词，教室号是第一个含数字的词；都不含数字时取校区后一个词
+  vector<pair<size_t, size_t> > words;
+  for (size_t i = pos; i < location.size ();)
+    {
+      while (i < location.size () && isRegexSpace (location[i]))
+        ++i;
+      size_t start = i;
+      while (i < location.size () && !isRegexSpace (location[i]))
+        ++i;
+      if (i > start)
+        words.push_back (make_pair (start, i));
+    }
+  size_t last = min ((size_t)1, words.size () - 1);
+  for (size_t w = 1; w < words.size (); ++w)
+    if (find_if (location.begin () + words[w].first,
+                 location.begin () + words[w].second,
+                 [] (char c) { return c >= '0' && c <= '9'; })
+        != location.begin () + words[w].second)
+      {
+        last = w;
+        break;
+      }
+  string room;
+  for (size_t w = 0; w <= last; ++w)
+    {
+      if (w)
+        room += ' ';
+      room.append (location, words[w].first,
+                   words[w].second - words[w].first);
+    }
+  return room;
+}
+
+void
+RoomIndex::add (const vector<Course> &courses)
+{
+  for (size_t i = 0; i < courses.size (); ++i)
+    {
+      const Course &c = courses[i];
+      string room = roomName (c.location.str ());
+      if (room.empty () || c.day < 0 || c.day >= 7)
+        continue;
+      map<string, Occupancy>::iterator it = rooms_.find (room);
+      if (it == rooms_.end ())
+        {
+          it = rooms_.insert (make_pair (room, Occupancy ())).first;
+          for (int k = 0; k < SLOT_COUNT; ++k)
+            it->second.slots[k] = 0;
+        }
+      int first = max (c.startPeriod, 1);
+      int last = min (c.endPeriod, PERIODS_PER_DAY);
+      for (int p = first; p <= last; ++p)
+        it->second.slots[slotIndex (c.day, p)] |= c.weeks;
+    }
+}
+
+void
+RoomIndex::merge (const RoomIndex &other)
+{
+  for (map<string, Occupancy>::const_iterator it = other.rooms_.begin ();
+       it != other.rooms_.end (); ++it)
+    {
+      map<string, Occupancy>::iterator mine = rooms_.find (it->first);
+      if (mine == rooms_.end ())
+        rooms_.insert (*it);
+      else
+        for (int k = 0; k < SLOT_COUNT; ++k)
+          mine->second.slots[k] |= it->second.slots[k];
+    }
+}
+
+static const char ROOMS_MAGIC[8] = { 'N', 'C', 'T', 'R', 'O', 'O', 'M', 'S' };
+static const uint32_t ROOMS_VERSION = 1;
+
+bool
+RoomIndex::save (const string &path) const
+{
+  string out (ROOMS_MAGIC, sizeof ROOMS_MAGIC);
+  putU32 (out, ROOMS_VERSION);
+  putU32 (out, (uint32_t)rooms_.size ());
+  for (map<string, Occupancy>::const_iterator it = rooms_.begin ();
+       it != rooms_.end (); ++it)
+    {
+      putString (out, it->first);
+      for (int k = 0; k < SLOT_COUNT; ++k)
+        putU64 (out, it->second.slots[k]);
+    }
+  string tmp = tempPath (path);
+  ofstream f (tmp.c_str (), ios::binary);
+  f << out;
+  f.close ();
+  if (f.fail ())
+    {
+      remove (tmp.c_str ());
+      return false;
+    }
+  return replaceFile (tmp, path);
+}
+
+bool
+RoomIndex::load (const string &path)
+{
+  ifstream in (path.c_str (), ios::binary);
+  if (!in)
+    return false;
+  string buf ((istreambuf_iterator<char> (in)), istreambuf_iterator<char> ());
+  CacheReader r (buf);
+  char magic[sizeof ROOMS_MAGIC];
+  uint32_t version, count;
+  if (!r.raw (magic, sizeof magic)
+      || memcmp (magic, ROOMS_MAGIC, sizeof magic) != 0 || !r.u32 (version)
+      || version != ROOMS_VERSION || !r.u32 (count))
+    return false;
+  rooms_.clear ();
+  for (uint32_t i = 0; i < count; ++i)
+    {
+      string name;
+      if (!r.str (name))
+        return false;
+      Occupancy &occ = rooms_[name];
+      for (int k = 0; k < SLOT_COUNT; ++k)
+        if (!r.u64 (occ.slots[k]))
+          return false;
+    }
+  return r.atEnd ();
+}
+
+vector<string>
+RoomIndex::freeRooms (const string &building, int firstWeek, int lastWeek,
+                      int day, int firstPeriod, int lastPeriod) const
+{
+  vector<string> result;
+  WeekMask weeks = weekRange (firstWeek, lastWeek);
+  firstPeriod = max (firstPeriod, 1);
+  lastPeriod = min (lastPeriod, PERIODS_PER_DAY);
+  if (day < 0 || day >= 7)
+    return result;
+  for (map<string, Occupancy>::const_iterator it = rooms_.begin ();
+       it != rooms_.end (); ++it)
+    {
+      if (it->first.find (building) == string::npos)
+        continue;
+      WeekMask busy = 0;
+      for (int p = firstPeriod; p <= lastPeriod; ++p)
+        busy |= it->second.slots[slotIndex (day, p)];
+      if (!(busy & weeks))
+        result.push_back (it->first);
+    }
+  return result;
+}
+
+vector<RoomUsage>
+RoomIndex::usage (const string &building, int firstWeek, int lastWeek) const
+{
+  vector<RoomUsage> result;
+  WeekMask weeks = weekRange (firstWeek, lastWeek);
+  for (map<string, Occupancy>::const_iterator it = rooms_.begin ();
+       it != rooms_.end (); ++it)
+    {
+      if (it->first.find (building) == string::npos)
+        continue;
+      RoomUsage u;
+      u.room = it->first;
+      u.busy = 0;
+      u.total = SLOT_COUNT * weekCount (weeks);
+      for (int k = 0; k < SLOT_COUNT; ++k)
+        u.busy += weekCount (it->second.slots[k] & weeks);
+      result.push_back (u);
+    }
+  stable_sort (result.begin (), result.end (),
+               [] (const RoomUsage &a, const RoomUsage &b) {
+                 return a.busy > b.busy;
+               });
+  return result;
+}
@@ -0,0 +1,752 @@
+/**
+ * @file NeuCourseCore.h
+ * @author PopulusYang
+ * @brief 课表解析与 ICS/CSV/HTML 生成的公共部分，供命令行程序与共享服务器
+ *        共用
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+#ifndef NEUCOURSECORE_H
+#define NEUCOURSECORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// ---- 课程数据 ----
+
+// 周数位图：第 w 周对应第 (w - 1) 位，支持 1-64 周
+typedef uint64_t WeekMask;
+const int MAX_WEEKS = 64;
+const WeekMask ODD_WEEKS = 0x5555555555555555ULL;  // 第 1, 3, 5... 周
+const WeekMask EVEN_WEEKS = 0xAAAAAAAAAAAAAAAAULL; // 第 2, 4, 6... 周
+
+// 第 start 到第 end 周的位图，超出 1-64 的部分被截掉
+inline WeekMask
+weekRange (int start, int end)
+{
+  if (start < 1)
+    start = 1;
+  if (end > MAX_WEEKS)
+    end = MAX_WEEKS;
+  if (start > end)
+    return 0;
+  return (~(WeekMask)0 >> (MAX_WEEKS - (end - start + 1))) << (start - 1);
+}
+
+// 位图中最小的周数，m 不能为 0
+inline int
+lowestWeek (WeekMask m)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanForward64 (&idx, m);
+  return (int)idx + 1;
+#else
+  return __builtin_ctzll (m) + 1;
+#endif
+}
+
+// 位图中最大的周数，m 不能为 0
+inline int
+highestWeek (WeekMask m)
+{
+#ifdef _MSC_VER
+  unsigned long idx;
+  _BitScanReverse64 (&idx, m);
+  return (int)idx + 1;
+#else
+  return 64 - __builtin_clzll (m);
+#endif
+}
+
+// 位图中的周数个数
+inline int
+weekCount (WeekMask m)
+{
+#ifdef _MSC_VER
+  return (int)__popcnt64 (m);
+#else
+  return __builtin_popcountll (m);
+#endif
+}
+
+// 驻留在 StringPool 中的一段以 '\0' 结尾的文字，内容不可变。复制只复制
+// 指针，在所属的池销毁之前有效
+class Text
+{
+public:
+  Text () : data_ (""), size_ (0) {}
+
+  const char *
+  data () const
+  {
+    return data_;
+  }
+  const char *
+  c_str () const
+  {
+    return data_;
+  }
+  size_t
+  size () const
+  {
+    return size_;
+  }
+  bool
+  empty () const
+  {
+    return size_ == 0;
+  }
+  std::string
+  str () const
+  {
+    return std::string (data_, size_);
+  }
+
+private:
+  friend class StringPool;
+  Text (const char *data, size_t size) : data_ (data), size_ (size) {}
+
+  const char *data_;
+  size_t size_;
+};
+
+std::ostream &operator<< (std::ostream &out, const Text &t);
+
+// 字符串驻留池。内容相同的字符串只保存一份，存放在成块分配的内存中，
+// 一份课表全部课程的字段只需几次堆分配；同一年级的教室、教师名大量重复，
+// 也只占一份空间。不可复制，不能由多个线程同时调用 intern
+class StringPool
+{
+public:
+  StringPool ();
+
+  Text intern (const char *p, size_t n);
+  Text
+  intern (const std::string &s)
+  {
+    return intern (s.data (), s.size ());
+  }
+
+  // 不同字符串的个数
+  size_t
+  size () const
+  {
+    return count_;
+  }
+
+private:
+  StringPool (const StringPool &);
+  StringPool &operator= (const StringPool &);
+
+  char *allocate (size_t n);
+  void rehash ();
+
+  std::vector<std::unique_ptr<char[]> > blocks_;
+  char *next_;     // 当前块中未用部分的起点
+  size_t left_;    // 当前块剩余的字节数
+  size_t blockSize_;
+  std::vector<Text> slots_; // 开放寻址的散列表，空位的 data () 为 NULL
+  size_t count_;
+};
+
+struct Course
+{
+  Text title;
+  Text location;
+  Text description;
+  Text weekStr; // 新增：原始周数信息
+  int day;
+  int startPeriod;
+  int endPeriod;
+  WeekMask weeks;
+};
+
+// 把 c 的各字段改为驻留到 strings 中
+void internCourse (StringPool &strings, Course &c);
+
+// 一份课表的解析结果
+struct Schedule
+{
+  std::vector<Course> courses; // 解析出的课程列表
+  std::string semesterInfo;    // 学期信息
+  // 各课程字段所在的池，复制 Schedule 时共用。只复制出 Course 时要保证
+  // 池仍然存在
+  std::shared_ptr<StringPool> strings;
+};
+
+// ---- 运行统计 ----
+
+// 转换过程中计时的步骤
+enum Stage
+{
+  STAGE_LOAD,    // 读取输入：stat、映射、散列、读缓存
+  STAGE_SPLIT,   // 按列切分，含提取学期信息
+  STAGE_SLOTS,   // 建立 div 索引、匹配课程格子
+  STAGE_EXTRACT, // 提取标题与详情，不含周数解析
+  STAGE_WEEKS,   // 解析周数
+  STAGE_ICS,     // 生成并写出 ICS
+  STAGE_CSV,     // 生成并写出 CSV
+  STAGE_HTML,    // 生成并写出旧版 HTML
+  STAGE_CACHE,   // 写出解析缓存
+  STAGE_COUNT
+};
+
+const char *stageName (Stage stage);
+
+// 一个步骤累计的耗时与处理量
+struct StageStats
+{
+  unsigned long long ns;
+  unsigned long long bytes;
+  unsigned long long calls;
+};
+
+// --stats 收集的统计。各函数收到 NULL 时不计时也不计数；多线程批量转换
+// 时每个任务各用一份，最后用 merge 汇总
+struct RunStats
+{
+  StageStats stages[STAGE_COUNT];
+  unsigned long long files;          // 处理的页面数
+  unsigned long long cacheHits;      // 命中解析缓存、未重新解析的页面数
+  unsigned long long emptyFiles;     // 未提取到课程的页面数
+  unsigned long long days;           // 找到的列（天）数
+  unsigned long long slots;          // 顶层课程格子数
+  unsigned long long titles;         // 匹配到的标题数
+  unsigned long long filteredTitles; // 被过滤的门户标题（“我的应用”等）
+  unsigned long long courses;        // 提取出的课程数
+  unsigned long long events;         // ICS 中的上课次数
+
+  RunStats ();
+  void merge (const RunStats &other);
+  void writeJson (std::ostream &out, double wallSeconds,
+                  unsigned threads) const;
+};
+
+unsigned long long monotonicNs ();
+
+// 计时一个步骤：构造时记下时间，stop 时累加到 stats；stats 为 NULL 时
+// 什么都不做
+class StageTimer
+{
+public:
+  StageTimer (RunStats *stats, Stage stage)
+      : stats_ (stats), stage_ (stage), start_ (stats ? monotonicNs () : 0)
+  {
+  }
+  ~StageTimer () { stop (0); }
+
+  void
+  stop (unsigned long long bytes)
+  {
+    if (!stats_)
+      return;
+    StageStats &s = stats_->stages[stage_];
+    s.ns += monotonicNs () - start_;
+    s.bytes += bytes;
+    ++s.calls;
+    stats_ = NULL;
+  }
+
+private:
+  RunStats *stats_;
+  Stage stage_;
+  unsigned long long start_;
+};
+
+// ---- 标记扫描 ----
+
+// 解析器要找的几种固定字节串
+enum MarkerKind
+{
+  MARK_DIV_OPEN,  // <div
+  MARK_DIV_CLOSE, // </div
+  MARK_FLEX,      // flex:
+  MARK_TITLE,     // class="title
+  MARK_INFO,      // class="kbappTimetableCourseRenderCourseItemInfoText
+  MARK_COLUMN,    // kbappTimetableDayColumnRoot
+  MARK_SELECTED,  // selected="">
+  MARK_KINDS
+};
+
+// 页面中各种标记的起点（相对页面开头的偏移），每种各自升序排列
+struct MarkerIndex
+{
+  std::vector<size_t> at[MARK_KINDS];
+};
+
+// 一次扫描 [data + from, data + to)，把完整落在区间内的全部标记写入
+// index。按 CPU 支持的指令集在 AVX2、SSE2 与逐字节的实现中选择
+void scanMarkers (const char *data, size_t from, size_t to,
+                  MarkerIndex &index);
+// 当前使用的实现："avx2"、"sse2" 或 "scalar"
+const char *markerScanner ();
+// 改用指定的实现，供基准测试对比；CPU 不支持时返回 false
+bool setMarkerScanner (const std::string &name);
+
+// ---- 解析 ----
+
+// 从课表页面的 HTML 中提取全部课程
+Schedule parseSchedule (const char *data, size_t size,
+                        RunStats *stats = NULL);
+
+// parseSchedule 的各个步骤，单独导出以便基准测试分别计时
+typedef std::vector<std::pair<size_t, size_t> > DayRanges;
+DayRanges splitDayColumns (const char *data, size_t size);
+DayRanges splitDayColumns (const char *data, size_t size,
+                           const MarkerIndex &marks);
+// marks 为 NULL 时先扫描各天区间
+void extractCourses (const char *data, const DayRanges &dayRanges,
+                     std::vector<Course> &courses, StringPool &strings,
+                     RunStats *stats = NULL, int firstDay = 0,
+                     const MarkerIndex *marks = NULL);
+WeekMask parseWeeks (const char *s, size_t n);
+WeekMask parseWeeks (const std::string &s);
+
+// 增量解析：页面分块送入 feed，每凑齐一天的列就提取其中的课程并丢掉
+// 用完的数据，缓冲区只需容纳最长的一列。结果与 parseSchedule 相同，唯一
+// 的例外是第七列闭合之后又出现列标记的页面：parseSchedule 会把第七列延伸
+// 到该标记，这里在第七列的闭合标签处结束
+class StreamParser
+{
+public:
+  explicit StreamParser (RunStats *stats = NULL);
+
+  void feed (const char *data, size_t size);
+  // 输入结束，返回解析结果
+  Schedule finish ();
+
+  // 缓冲区曾经达到的最大字节数
+  size_t
+  peakBuffered () const
+  {
+    return peak_;
+  }
+
+private:
+  const char *
+  at (size_t offset) const
+  {
+    return buf_.data () + (offset - base_);
+  }
+  size_t
+  offsetOf (const char *p) const
+  {
+    return base_ + (p - buf_.data ());
+  }
+
+  void scanSemester (bool eof);
+  void scanColumns (bool eof, DayRanges &ready);
+  int findColumnClose (const char *limit, bool eof, size_t &close);
+  void process (bool eof, size_t fed);
+
+  RunStats *stats_;
+  std::string buf_;
+  size_t base_; // buf_[0] 在输入中的偏移，以下偏移都相对输入开头
+  size_t peak_;
+  Schedule sched_;
+  bool semesterFound_;
+  size_t semesterScan_; // 学期信息的查找起点
+  size_t markScan_;     // 下一个列标记的查找起点
+  size_t closeScan_;    // 当前列闭合标签的查找起点
+  bool pending_;        // 有一列已找到起点、尚未确定终点
+  size_t colStart_;
+  size_t colMark_;
+  int days_; // 已确定区间的列数
+  bool done_;
+};
+
+// ---- 日历 ----
+
+// 学期日历：只解析一次起始周日，预先算好每个 (周, 星期) 的 YYYYMMDD
+class SemesterCalendar
+{
+public:
+  explicit SemesterCalendar (const std::string &startSunday);
+
+  // 距起始周日 offset 天的日期，形如 "20260301"；起始日期无法解析或
+  // 结果的年份超出四位数时统一返回 "19700101"
+  const char *
+  date (int offset, char *buf) const
+  {
+    if (offset >= 0 && offset < TABLE_DAYS)
+      return table_[offset];
+    format (offset, buf);
+    return buf;
+  }
+
+  // 第 week 周（从 1 开始）星期 day（0 为周日）的日期
+  const char *
+  date (int week, int day, char *buf) const
+  {
+    return date (day + (week - 1) * 7, buf);
+  }
+
+  // 起始日期能否解析，年份须在 1-9998 之间
+  bool
+  valid () const
+  {
+    return valid_;
+  }
+
+private:
+  static const int TABLE_DAYS = MAX_WEEKS * 7;
+
+  void format (int offset, char *out) const;
+
+  bool valid_;
+  long long epochDay_;
+  char table_[TABLE_DAYS][9];
+};
+
+const char *getTime (int period, bool isStart);
+
+// ---- 输出 ----
+
+// 一个 VEVENT。body 是除 UID/DTSTAMP/SEQUENCE 外的全部属性行，
+// 两次生成之间 body 不同即视为事件有变更
+struct IcsEvent
+{
+  std::string uid;
+  int sequence;
+  std::string body;
+};
+
+// 增量日历中各类事件的个数
+struct IcsDelta
+{
+  int added;
+  int changed;
+  int cancelled;
+};
+
+// 一门课的一个 VEVENT 中与所在课表无关的部分。uidKey 为生成 UID 的键，
+// uid 为该键在课表中只出现一次时的 UID
+struct CourseEvent
+{
+  std::string uidKey;
+  std::string uid;
+  std::string body;
+};
+
+// 一个教学班：一门课程及其各种输出的片段，由 SectionTable 生成
+struct Section
+{
+  Course course;
+  std::vector<CourseEvent> events;
+  int classes;           // 上课次数
+  std::string csvRows;   // CSV 中的记录
+  std::string htmlTitle; // 旧版 HTML 单元格 title 属性中的一项
+  std::string htmlBox;   // 旧版 HTML 单元格中的一项
+};
+
+int buildIcsEvents (const std::vector<Course> &courses,
+                    const std::string &startSunday, bool expanded,
+                    std::vector<IcsEvent> &events);
+int buildIcsEvents (const std::vector<const Section *> &sections,
+                    std::vector<IcsEvent> &events);
+void readIcsEvents (std::istream &in, std::vector<IcsEvent> &events);
+IcsDelta applyPrevious (std::vector<IcsEvent> &events,
+                        const std::vector<IcsEvent> &previous,
+                        std::vector<IcsEvent> *delta,
+                        std::vector<IcsEvent> *cancelled);
+std::string icsTimestamp ();
+std::string icsTimestamp (long long when);
+std::string inputTimestamp (long long mtime);
+void writeIcsCalendar (std::ostream &ics, const std::vector<IcsEvent> &events,
+                       const std::vector<IcsEvent> &cancelled,
+                       const std::string &stamp);
+int writeIcs (std::ostream &ics, const std::vector<Course> &courses,
+              const std::string &startSunday, bool expanded);
+void writeCsv (std::ostream &csv, const std::vector<Course> &courses);
+void writeCsv (std::ostream &csv,
+               const std::vector<const Section *> &sections);
+std::string renderOldHtml (const std::vector<Course> &courses,
+                           const std::string &semesterInfo);
+std::string renderOldHtml (const std::vector<const Section *> &sections,
+                           const std::string &semesterInfo);
+void escapeHtml (const char *p, size_t n, std::string &out);
+std::string escapeHtml (const std::string &s);
+
+// 批量转换时各学生共用的教学班表。课程名、地点、详情、周数、星期和
+// 节次都相同的课程只保存一份，其 ICS 事件、CSV 记录和 HTML 片段也只
+// 生成一次，拼装各学生的输出时直接引用。可由多个线程同时使用
+class SectionTable
+{
+public:
+  // 表中最多保存的教学班个数，约 1.7 KB 一个。学生之间很少共用教学班时
+  // 表满后的新教学班不再保存，内存不会随学生数一直增长
+  static const size_t DEFAULT_CAPACITY = 16384;
+
+  SectionTable (const std::string &startSunday, bool expandedIcs,
+                size_t capacity = DEFAULT_CAPACITY);
+
+  // 与 c 相同的教学班，第一次遇到时生成各片段。返回的指针在表的生存期
+  // 内一直有效；表已满且其中没有该教学班时返回 NULL
+  const Section *intern (const Course &c);
+
+  // 片段是否按这组参数生成
+  bool
+  renders (const std::string &startSunday, bool expandedIcs) const
+  {
+    return startSunday == startSunday_ && expandedIcs == expanded_;
+  }
+
+  size_t size () const;
+
+private:
+  static const size_t SHARDS = 16; // 按键的散列分片加锁，减少线程争用
+  struct Shard
+  {
+    mutable std::mutex lock;
+    std::unordered_map<std::string, std::unique_ptr<Section> > sections;
+  };
+
+  void render (const Course &c, Section &sec);
+
+  std::string startSunday_;
+  SemesterCalendar calendar_;
+  bool expanded_;
+  size_t capacity_;
+  std::atomic<size_t> size_;
+  Shard shards_[SHARDS];
+  std::mutex stringsLock_;
+  StringPool strings_; // 各教学班 course 的字段
+};
+
+// ---- 文件与目录 ----
+
+// 只读映射整个文件，解析直接在映射的内存上进行，避免把页面读入 string
+class MappedFile
+{
+public:
+  MappedFile ();
+  ~MappedFile () { close (); }
+
+  bool open (const std::string &path);
+  void close ();
+
+  const char *
+  data () const
+  {
+    return data_;
+  }
+  size_t
+  size () const
+  {
+    return size_;
+  }
+
+private:
+  MappedFile (const MappedFile &);
+  MappedFile &operator= (const MappedFile &);
+
+  const char *data_;
+  size_t size_;
+#ifdef _WIN32
+  void *mapping_; // 文件映射对象的 HANDLE
+#endif
+};
+
+bool isDirectory (const std::string &path);
+bool isRegularFile (const std::string &path);
+std::string joinPath (const std::string &dir, const std::string &name);
+bool makeDirs (const std::string &path);
+std::vector<std::string> listDirectory (const std::string &dir);
+// 写输出文件时先写到 tempPath (path)，写完再由 replaceFile 改名替换，
+// 同时读取的共享服务器看到的总是完整的旧文件或新文件
+std::string tempPath (const std::string &path);
+bool replaceFile (const std::string &tmp, const std::string &path);
+bool hasSuffix (const std::string &s, const std::string &suffix);
+
+// ---- 解析结果缓存 ----
+
+const long long UNKNOWN_MTIME = -1;
+
+// 缓存文件的内容
+struct ScheduleCache
+{
+  uint64_t size;         // 输入文件大小
+  long long mtime;       // 输入修改时间，不可信时为 UNKNOWN_MTIME
+  long long inputMtime;  // 输入实际的修改时间，用作 DTSTAMP，不写进缓存
+  uint64_t hash;         // 输入内容散列
+  std::string outputKey; // 上次写出输出文件时的参数，尚未输出时为空
+  Schedule sched;
+};
+
+uint64_t hashBytes (const char *p, size_t n);
+bool readScheduleCache (const std::string &path, ScheduleCache &cache);
+bool writeScheduleCache (const std::string &path, const ScheduleCache &cache,
+                         RunStats *stats = NULL);
+bool loadSchedule (const std::string &input, const std::string &cachePath,
+                   bool useCache, ScheduleCache &cache, bool &hit,
+                   bool &dirty, size_t &bytes, std::string &err,
+                   RunStats *stats = NULL);
+
+// ---- 输出文件 ----
+
+// 转换相关的选项
+struct OutputOptions
+{
+  bool expandedIcs; // 每周一个 VEVENT 的旧格式
+  bool deltaIcs;    // 另写只含变动事件的 schedule-delta.ics
+  bool useCache;    // 为 false 时不读写 schedule.cache
+
+  OutputOptions () : expandedIcs (false), deltaIcs (false), useCache (true) {}
+
+  // 影响输出文件内容的参数，输入和它都没变时输出无需重写
+  std::string outputKey (const std::string &startSunday) const;
+};
+
+// 一次输出的结果统计
+struct OutputSummary
+{
+  int events;     // ICS 中的上课次数
+  IcsDelta delta; // 与上一次生成的 schedule.ics 相比的变动
+};
+
+bool writeOutputs (const std::string &dir, const Schedule &sched,
+                   const std::string &startSunday, long long sourceTime,
+                   const OutputOptions &opts, OutputSummary &summary,
+                   std::string &err, RunStats *stats = NULL,
+                   SectionTable *sections = NULL);
+
+// ---- 多页面任务 ----
+
+// 一个待转换的页面
+struct BatchJob
+{
+  std::string input; // HTML 文件路径
+  std::string name;  // 输出子目录名（通常为学号）
+};
+
+bool collectJobs (const std::string &source, std::vector<BatchJob> &jobs,
+                  std::string &err);
+void runWorkStealing (size_t jobCount, unsigned threads,
+                      const std::function<void (size_t)> &work);
+bool loadScheduleSet (const std::string &source, unsigned threads,
+                      std::vector<BatchJob> &jobs,
+                      std::vector<Schedule> &scheds,
+                      std::vector<bool> &loaded, std::string &err);
+
+// ---- 空闲时间 ----
+
+const int PERIODS_PER_DAY = 12;
+const int SLOT_COUNT = 7 * PERIODS_PER_DAY;
+
+// (星期, 节次) 格子的下标，星期 0 为周日，节次从 1 开始
+inline int
+slotIndex (int day, int period)
+{
+  return day * PERIODS_PER_DAY + period - 1;
+}
+
+// 一名学生在每个格子上有课的周
+struct Occupancy
+{
+  WeekMask slots[SLOT_COUNT];
+};
+
+void buildOccupancy (const std::vector<Course> &courses, Occupancy &occ);
+
+// 一组学生的空闲时间查询。按 (格子, 周) 存放有课学生的位图，每名学生
+// 一位，查询时对 64 名学生一组做 OR 与 popcount，不再逐个学生判断
+class FreeTimeIndex
+{
+public:
+  FreeTimeIndex () : students_ (0), words_ (0) {}
+
+  // 以 students 的顺序作为学生下标
+  void build (const std::vector<Occupancy> &students);
+
+  size_t
+  size () const
+  {
+    return students_;
+  }
+
+  // 每个学生一位的位图，用作 countFree 的 selection
+  std::vector<uint64_t>
+  emptySelection () const
+  {
+    return std::vector<uint64_t> (words_, 0);
+  }
+
+  // 第 firstWeek 到 lastWeek 周内每个格子都没有课的学生数；selection
+  // 为参与统计的学生，NULL 表示全部
+  void countFree (int firstWeek, int lastWeek,
+                  const std::vector<uint64_t> *selection,
+                  int counts[SLOT_COUNT]) const;
+
+private:
+  size_t students_;
+  size_t words_;
+  std::vector<uint64_t> busy_; // 下标 ((格子 * 64 + 周 - 1) * words_ + 字)
+};
+
+// countFree 的结果中空闲人数不少于 minFree 的格子，以 JSON 写出
+void writeFreeJson (std::ostream &out, const int counts[SLOT_COUNT],
+                    int minFree, size_t students, int firstWeek,
+                    int lastWeek, const std::vector<std::string> &unknown);
+
+// ---- 教室占用 ----
+
+// 地点中的教室名：从校区到第一个含数字的词（教室号）为止，去掉其后的
+// 教师姓名。不含校区的地点（如“实验室”）不是具体教室，返回空串
+std::string roomName (const std::string &location);
+
+// 一间教室的使用情况，busy 与 total 以“节次 × 周”计
+struct RoomUsage
+{
+  std::string room;
+  int busy;
+  int total;
+};
+
+// 教室到占用位图的倒排索引。批量转换时由各学生的课程汇总而成，同一
+// 教学班出现在多名学生的课表里，按位或即可去重；查询只读位图
+class RoomIndex
+{
+public:
+  void add (const std::vector<Course> &courses);
+  void merge (const RoomIndex &other);
+
+  size_t
+  size () const
+  {
+    return rooms_.size ();
+  }
+
+  bool save (const std::string &path) const;
+  bool load (const std::string &path);
+
+  // 名称含 building 的教室中，第 firstWeek 到 lastWeek 周星期 day
+  // 第 firstPeriod 到 lastPeriod 节都没有课的
+  std::vector<std::string> freeRooms (const std::string &building,
+                                      int firstWeek, int lastWeek, int day,
+                                      int firstPeriod, int lastPeriod) const;
+  // 名称含 building 的教室在第 firstWeek 到 lastWeek 周的使用率，
+  // 从高到低排列
+  std::vector<RoomUsage> usage (const std::string &building, int firstWeek,
+                                int lastWeek) const;
+
+private:
+  std::map<std::string, Occupancy> rooms_;
+};
+
+#endif // NEUCOURSECORE_H
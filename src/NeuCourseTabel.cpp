@@ -6,791 +6,1623 @@
  * @date 2026-01-12
  */
 
+#include "NeuCourseCore.h"
+
 #include <algorithm>
-#include <ctime>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
-#include <regex>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 using namespace std;
 
-string
-trim (string s)
+// 转换相关的命令行选项
+struct CommandOptions : OutputOptions
+{
+  bool stats;       // --stats[=文件]：输出各步骤耗时与计数的 JSON
+  string statsPath; // 统计写入的文件，为空时写到标准错误
+
+  CommandOptions () : stats (false) {}
+
+  // 识别一个选项，不认识的参数返回 false
+  bool
+  parse (const string &arg)
+  {
+    if (arg == "--expand-ics")
+      expandedIcs = true;
+    else if (arg == "--delta")
+      deltaIcs = true;
+    else if (arg == "--no-cache")
+      useCache = false;
+    else if (arg == "--stats")
+      stats = true;
+    else if (arg.compare (0, 8, "--stats=") == 0)
+      {
+        stats = true;
+        statsPath = arg.substr (8);
+      }
+    else
+      return false;
+    return true;
+  }
+
+  // 写出统计 JSON
+  bool
+  writeStats (const RunStats &s, double wallSeconds, unsigned threads) const
+  {
+    if (statsPath.empty ())
+      {
+        s.writeJson (cerr, wallSeconds, threads);
+        return true;
+      }
+    ofstream out (statsPath.c_str ());
+    s.writeJson (out, wallSeconds, threads);
+    out.close ();
+    if (out.fail ())
+      {
+        cerr << "无法写入统计文件 " << statsPath << endl;
+        return false;
+      }
+    return true;
+  }
+};
+
+// ---- 批量模式 ----
+
+// 一个页面的转换结果
+struct BatchResult
 {
-  size_t first = s.find_first_not_of (" \n\r\t");
-  if (string::npos == first)
-    return "";
-  size_t last = s.find_last_not_of (" \n\r\t");
-  return s.substr (first, (last - first + 1));
+  bool ok;
+  bool skipped; // 输入与输出参数都没变，沿用了上次的输出
+  size_t bytes;
+  size_t courses;
+  string error;
+  RunStats stats; // --stats 时该页面的统计
+};
+
+// 记录一个页面载入后的计数，stats 为 NULL 时什么都不做
+void
+countSchedule (RunStats *stats, const Schedule &sched, bool cacheHit)
+{
+  if (!stats)
+    return;
+  ++stats->files;
+  if (cacheHit)
+    ++stats->cacheHits;
+  stats->courses += sched.courses.size ();
+  if (sched.courses.empty ())
+    ++stats->emptyFiles;
 }
 
-string
-clean (string s)
+// 批量转换时汇总各页面的教室占用，各线程先建好自己页面的部分再合并
+struct RoomCollector
+{
+  RoomIndex index;
+  mutex lock;
+
+  void
+  add (const vector<Course> &courses)
+  {
+    RoomIndex local;
+    local.add (courses);
+    lock_guard<mutex> guard (lock);
+    index.merge (local);
+  }
+};
+
+// 转换单个页面，任何异常都只影响该页面。rooms 不为 NULL 时把页面的
+// 教室占用汇总进去；sections 不为 NULL 时输出由其中共用的教学班片段
+// 拼装
+void
+convertJob (const BatchJob &job, const string &outRoot,
+            const string &startSunday, const CommandOptions &opts,
+            BatchResult &res, RoomCollector *rooms = NULL,
+            SectionTable *sections = NULL)
 {
-  string t = trim (s);
-  string res;
-  bool lastSpace = false;
-  for (char c : t)
+  res.ok = false;
+  res.skipped = false;
+  res.bytes = 0;
+  res.courses = 0;
+  try
     {
-      if (isspace (c))
+      string dir = joinPath (outRoot, job.name);
+      string cachePath = joinPath (dir, "schedule.cache");
+      ScheduleCache cache;
+      bool hit, dirty;
+      RunStats *stats = opts.stats ? &res.stats : NULL;
+      if (!loadSchedule (job.input, cachePath, opts.useCache, cache, hit,
+                         dirty, res.bytes, res.error, stats))
+        return;
+      res.courses = cache.sched.courses.size ();
+      countSchedule (stats, cache.sched, hit);
+      if (rooms)
+        rooms->add (cache.sched.courses);
+
+      string key = opts.outputKey (startSunday);
+      if (hit && cache.outputKey == key
+          && isRegularFile (joinPath (dir, "schedule.ics")))
         {
-          if (!lastSpace)
-            res += ' ';
-          lastSpace = true;
+          res.skipped = true;
+          res.ok = true;
+          // 上次的增量日历已经过时，这次没有任何变动
+          if (opts.deltaIcs)
+            {
+              string deltaPath = joinPath (dir, "schedule-delta.ics");
+              ofstream deltaIcs (tempPath (deltaPath).c_str ());
+              writeIcsCalendar (deltaIcs, vector<IcsEvent> (),
+                                vector<IcsEvent> (),
+                                inputTimestamp (cache.inputMtime));
+              deltaIcs.close ();
+              replaceFile (tempPath (deltaPath), deltaPath);
+            }
         }
       else
         {
-          res += c;
-          lastSpace = false;
+          OutputSummary summary;
+          res.ok = writeOutputs (dir, cache.sched, startSunday,
+                                 cache.inputMtime, opts, summary, res.error,
+                                 stats, sections);
+          if (stats)
+            stats->events += summary.events;
+          if (res.ok && cache.outputKey != key)
+            {
+              cache.outputKey = key;
+              dirty = opts.useCache;
+            }
         }
+      if (res.ok && dirty)
+        writeScheduleCache (cachePath, cache, stats);
     }
-  return res;
-}
-
-// 辅助函数：转义 CSV 中的特殊字符
-string
-csvQuote (string s)
-{
-  string res = "\"";
-  for (char c : s)
+  catch (const exception &e)
     {
-      if (c == '"')
-        res += "\"\"";
-      else
-        res += c;
+      res.error = job.input + ": " + e.what ();
+    }
+  catch (...)
+    {
+      res.error = job.input + ": 未知错误";
     }
-  res += "\"";
-  return res;
 }
 
-// 辅助函数：转义 HTML 属性中的双引号
-string
-escapeHtml (string s)
+void
+printUsage ()
 {
-  string res;
-  for (char c : s)
-    {
-      if (c == '\"')
-        res += "&quot;";
-      else if (c == '\'')
-        res += "&#39;";
-      else if (c == '<')
-        res += "&lt;";
-      else if (c == '>')
-        res += "&gt;";
-      else if (c == '&')
-        res += "&amp;";
-      else
-        res += c;
-    }
-  return res;
+  cerr << "用法:\n"
+          "  NeuCourseTabel [YYYY-MM-DD] [选项]\n"
+          "      解析当前目录下的 exp.html\n"
+          "  NeuCourseTabel --batch <输入目录|清单文件> <输出目录> "
+          "<YYYY-MM-DD> [--jobs N] [选项]\n"
+          "      批量转换，每个学生的结果写入输出目录下的独立子目录\n"
+          "  NeuCourseTabel --pipe <ics|csv|html> [YYYY-MM-DD] [选项]\n"
+          "      从标准输入读取页面，边读边解析，把所选格式写到标准输出；"
+          "ics 需要日期\n"
+          "  NeuCourseTabel --serve <套接字路径|-> [--jobs N]\n"
+          "      常驻模式，在 Unix 套接字（- 为标准输入/输出）上接受转换"
+          "任务，协议见 README\n"
+          "  NeuCourseTabel --watch <exp.html|输入目录> <输出目录> "
+          "<YYYY-MM-DD> [--debounce 毫秒] [--jobs N] [选项]\n"
+          "      监视页面，改动后自动重新生成输出（仅 Linux）\n"
+          "  NeuCourseTabel --free <输入目录|清单文件|批量输出目录> "
+          "[--ids 学号,...] [--weeks a-b] [--min k] [--json]\n"
+          "      列出所选学生（默认全部）在第 a-b 周中至少 k 人（默认全部）"
+          "都没有课的节次\n"
+          "  NeuCourseTabel --rooms <批量输出目录|rooms.index|输入目录> "
+          "[--building X] [--weeks a-b] [--day D --periods a-b]\n"
+          "      给出 --day 时列出空教室（D 为 1-7，7 为周日），否则列出"
+          "教室使用率\n"
+          "选项:\n"
+          "  --expand-ics  ICS 中每周写一个独立事件，不使用 RRULE 重复规则\n"
+          "  --delta       对照上次生成的 schedule.ics，另写只含新增、变更和"
+          "取消事件的 schedule-delta.ics\n"
+          "  --no-cache    不读写 schedule.cache，总是重新解析 HTML\n"
+          "  --stats[=文件]  以 JSON 输出各步骤的耗时、字节数和计数，默认"
+          "写到标准错误"
+       << endl;
 }
 
-struct Course
+// --jobs 的上限，常驻模式会按它启动同样多的线程
+const long MAX_JOBS = 1024;
+
+// 解析 --jobs 的线程数，只接受 1 到 MAX_JOBS 的整数
+bool
+parseJobs (const char *text, unsigned &threads)
 {
-  string title;
-  string location;
-  string description;
-  string weekStr; // 新增：原始周数信息
-  int day;
-  int startPeriod;
-  int endPeriod;
-  vector<int> weeks;
-};
+  char *end;
+  errno = 0;
+  long n = strtol (text, &end, 10);
+  if (end == text || *end || errno || n < 1 || n > MAX_JOBS)
+    {
+      cerr << "无法解析线程数 " << text << "（应为 1-" << MAX_JOBS
+           << " 的整数）" << endl;
+      return false;
+    }
+  threads = (unsigned)n;
+  return true;
+}
 
-// 解析周数逻辑：处理 1-12周, 9周, 11-13周(单/双) 等
-vector<int>
-parseWeeks (string s)
+int
+runBatch (int argc, char *argv[])
 {
-  vector<int> weeks;
-  regex weekPartRegex ("([0-9\\-,]+)周(\\((单|双)\\))?");
-  auto words_begin = sregex_iterator (s.begin (), s.end (), weekPartRegex);
-  auto words_end = sregex_iterator ();
+  vector<string> positional;
+  CommandOptions opts;
+  unsigned threads = thread::hardware_concurrency ();
+  for (int i = 2; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--jobs" && i + 1 < argc)
+        {
+          if (!parseJobs (argv[++i], threads))
+            return 1;
+        }
+      else if (!opts.parse (arg))
+        positional.push_back (arg);
+    }
+  if (positional.size () != 3)
+    {
+      printUsage ();
+      return 1;
+    }
+  if (threads == 0)
+    threads = 1;
+  const string &source = positional[0];
+  const string &outRoot = positional[1];
+  const string &startSunday = positional[2];
+  if (!SemesterCalendar (startSunday).valid ())
+    {
+      cerr << "无法解析日期 " << startSunday << endl;
+      return 1;
+    }
 
-  for (sregex_iterator i = words_begin; i != words_end; ++i)
+  vector<BatchJob> jobs;
+  string err;
+  if (!collectJobs (source, jobs, err))
+    {
+      cerr << err << endl;
+      return 1;
+    }
+  if (!makeDirs (outRoot))
     {
-      smatch match = *i;
-      string rangeStr = match[1].str ();
-      string type = match[3].str (); // "单" 或 "双" 或 ""
+      cerr << "无法创建输出目录 " << outRoot << endl;
+      return 1;
+    }
 
-      stringstream ss (rangeStr);
-      string segment;
-      while (getline (ss, segment, ','))
+  // 输出子目录重名的任务会互相覆盖，直接判为失败
+  vector<BatchResult> results (jobs.size ());
+  vector<bool> runnable (jobs.size (), true);
+  {
+    vector<pair<string, size_t> > names;
+    for (size_t i = 0; i < jobs.size (); ++i)
+      names.push_back (make_pair (jobs[i].name, i));
+    sort (names.begin (), names.end ());
+    for (size_t i = 1; i < names.size (); ++i)
+      if (names[i].first == names[i - 1].first)
         {
-          segment = trim (segment);
-          if (segment.empty ())
-            continue;
-          size_t dash = segment.find ('-');
-          int start = 0, end = 0;
-          try
-            {
-              if (dash != string::npos)
-                {
-                  string s1 = segment.substr (0, dash);
-                  string s2 = segment.substr (dash + 1);
-                  if (s1.empty () || s2.empty ())
-                    continue;
-                  start = stoi (s1);
-                  end = stoi (s2);
-                }
-              else
-                {
-                  start = end = stoi (segment);
-                }
-            }
-          catch (...)
-            {
-              continue;
-            }
-
-          for (int w = start; w <= end; ++w)
-            {
-              if (type == "单" && w % 2 == 0)
-                continue;
-              if (type == "双" && w % 2 != 0)
-                continue;
-              weeks.push_back (w);
-            }
+          size_t j = names[i].second;
+          runnable[j] = false;
+          results[j].ok = false;
+          results[j].skipped = false;
+          results[j].bytes = 0;
+          results[j].courses = 0;
+          results[j].error = jobs[j].input + ": 输出子目录重名 " + jobs[j].name;
+        }
+  }
+
+  // 与 runWorkStealing 一致，线程数不超过任务数
+  threads = (unsigned)min<size_t> (threads, max<size_t> (jobs.size (), 1));
+  chrono::steady_clock::time_point t0 = chrono::steady_clock::now ();
+  RoomCollector rooms;
+  // 同一院系、同一年级的学生大多选了相同的教学班，各片段只生成一次
+  SectionTable sections (startSunday, opts.expandedIcs);
+  runWorkStealing (jobs.size (), threads, [&] (size_t i) {
+    if (runnable[i])
+      convertJob (jobs[i], outRoot, startSunday, opts, results[i], &rooms,
+                  &sections);
+  });
+  string roomsPath = joinPath (outRoot, "rooms.index");
+  bool roomsSaved = rooms.index.save (roomsPath);
+  double seconds = chrono::duration<double> (chrono::steady_clock::now () - t0)
+                       .count ();
+
+  size_t okCount = 0, failCount = 0, emptyCount = 0, skipCount = 0;
+  unsigned long long totalBytes = 0;
+  for (size_t i = 0; i < results.size (); ++i)
+    {
+      totalBytes += results[i].bytes;
+      if (!results[i].ok)
+        {
+          ++failCount;
+          cerr << "失败: " << results[i].error << endl;
+          continue;
         }
+      ++okCount;
+      if (results[i].skipped)
+        ++skipCount;
+      if (results[i].courses == 0)
+        {
+          ++emptyCount;
+          cerr << "警告: " << jobs[i].input << " 未提取到课程" << endl;
+        }
+    }
+
+  if (seconds <= 0)
+    seconds = 1e-9;
+  cout << "批量转换完成：共 " << jobs.size () << " 个文件，成功 " << okCount
+       << " 个（其中 " << skipCount << " 个未变化已跳过，" << emptyCount
+       << " 个未提取到课程），失败 "
+       << failCount << " 个" << endl;
+  cout << fixed << setprecision (2) << "线程数 " << threads << "，耗时 "
+       << seconds << " s，吞吐 " << jobs.size () / seconds << " files/s，"
+       << totalBytes / seconds / (1024.0 * 1024.0) << " MB/s" << endl;
+  if (sections.size ())
+    cout << "教学班：" << sections.size () << " 个不同的教学班" << endl;
+  if (roomsSaved)
+    cout << "教室索引：" << rooms.index.size () << " 间教室，已写入 "
+         << roomsPath << endl;
+  else
+    cerr << "无法写入教室索引 " << roomsPath << endl;
+
+  if (opts.stats)
+    {
+      RunStats total;
+      for (size_t i = 0; i < results.size (); ++i)
+        total.merge (results[i].stats);
+      if (!opts.writeStats (total, seconds, threads))
+        return 1;
     }
-  if (weeks.empty ())
-    for (int i = 1; i <= 16; ++i)
-      weeks.push_back (i);
-  return weeks;
+  return failCount == 0 ? 0 : 1;
 }
 
-// 位置
-string
-formatLocation (string s)
+// ---- 管道模式 ----
+
+// 转发到另一个 streambuf 并统计字节数，标准输出接到管道时无法 tellp
+class CountingBuf : public streambuf
 {
-  size_t pos = s.find ("浑南校区");
-  if (pos == string::npos)
-    pos = s.find ("南湖校区");
-  if (pos != string::npos)
+public:
+  explicit CountingBuf (streambuf *dest) : dest_ (dest), count_ (0) {}
+
+  unsigned long long
+  count () const
+  {
+    return count_;
+  }
+
+protected:
+  int_type
+  overflow (int_type c)
+  {
+    if (traits_type::eq_int_type (c, traits_type::eof ()))
+      return traits_type::not_eof (c);
+    ++count_;
+    return dest_->sputc (traits_type::to_char_type (c));
+  }
+  streamsize
+  xsputn (const char *s, streamsize n)
+  {
+    streamsize written = dest_->sputn (s, n);
+    count_ += written;
+    return written;
+  }
+  int
+  sync ()
+  {
+    return dest_->pubsync ();
+  }
+
+private:
+  streambuf *dest_;
+  unsigned long long count_;
+};
+
+int
+runPipe (int argc, char *argv[])
+{
+  vector<string> positional;
+  CommandOptions opts;
+  for (int i = 2; i < argc; ++i)
+    if (!opts.parse (argv[i]))
+      positional.push_back (argv[i]);
+  string format = positional.empty () ? "" : positional[0];
+  size_t wanted = format == "ics" ? 2 : 1;
+  if ((format != "ics" && format != "csv" && format != "html")
+      || positional.size () != wanted)
+    {
+      printUsage ();
+      return 1;
+    }
+  if (format == "ics" && !SemesterCalendar (positional[1]).valid ())
+    {
+      cerr << "无法解析日期 " << positional[1] << endl;
+      return 1;
+    }
+#ifdef _WIN32
+  _setmode (_fileno (stdin), _O_BINARY);
+  _setmode (_fileno (stdout), _O_BINARY);
+#endif
+  ios::sync_with_stdio (false); // 标准输入只用 fread 读取
+
+  // 分块读取，每凑齐一列就提取，缓冲区只需容纳最长的一列
+  RunStats runStats;
+  RunStats *stats = opts.stats ? &runStats : NULL;
+  unsigned long long t0 = monotonicNs ();
+  StreamParser parser (stats);
+  vector<char> chunk (64 * 1024);
+  while (true)
+    {
+      StageTimer loadTimer (stats, STAGE_LOAD);
+      size_t n = fread (&chunk[0], 1, chunk.size (), stdin);
+      loadTimer.stop (n);
+      if (n == 0)
+        break;
+      parser.feed (&chunk[0], n);
+    }
+  if (ferror (stdin))
+    {
+      cerr << "读取标准输入失败" << endl;
+      return 1;
+    }
+  Schedule sched = parser.finish ();
+  countSchedule (stats, sched, false);
+  if (sched.courses.empty ())
+    cerr << "警告: 未提取到课程" << endl;
+
+  // 直接写到标准输出，展开式 ICS 可达数 MB，不在内存中另存一份
+  CountingBuf counter (cout.rdbuf ());
+  ostream out (&counter);
+  Stage stage = format == "ics"   ? STAGE_ICS
+                : format == "csv" ? STAGE_CSV
+                                  : STAGE_HTML;
+  StageTimer outputTimer (stats, stage);
+  if (format == "ics")
+    runStats.events += writeIcs (out, sched.courses, positional[1],
+                                 opts.expandedIcs);
+  else if (format == "csv")
+    writeCsv (out, sched.courses);
+  else
+    out << renderOldHtml (sched.courses, sched.semesterInfo);
+  out.flush ();
+  outputTimer.stop (counter.count ());
+  if (!out || !cout)
     {
-      return trim (s.substr (pos));
+      cerr << "写入标准输出失败" << endl;
+      return 1;
     }
-  return trim (s);
+
+  if (opts.stats
+      && !opts.writeStats (runStats, (monotonicNs () - t0) / 1e9, 1))
+    return 1;
+  return 0;
 }
 
-string
-addDays (string startDate, int days)
+// ---- 空闲时间 ----
+
+// 解析 "a-b" 或单个数 "a"
+bool
+parseRange (const string &text, int &first, int &last)
 {
-  struct tm tm = {};
-  int y, m, d;
-  char sep;
-  stringstream ss (startDate);
-  if (!(ss >> y >> sep >> m >> sep >> d))
-    return "19700101";
-  tm.tm_year = y - 1900;
-  tm.tm_mon = m - 1;
-  tm.tm_mday = d;
-  tm.tm_isdst = -1;
-
-  time_t t = mktime (&tm);
-  t += (long long)days * 24 * 60 * 60;
-  struct tm *newTm = localtime (&t);
-
-  ostringstream oss;
-  oss << setfill ('0') << setw (4) << (newTm->tm_year + 1900) << setw (2)
-      << (newTm->tm_mon + 1) << setw (2) << newTm->tm_mday;
-  return oss.str ();
+  int n = sscanf (text.c_str (), "%d-%d", &first, &last);
+  if (n == 1)
+    last = first;
+  return n >= 1 && first <= last;
 }
 
-string
-getTime (int period, bool isStart)
+// 解析 --day 的 1-7（7 为周日），得到 0 为周日的星期
+bool
+parseDay (const char *text, int &day)
+{
+  char *end;
+  errno = 0;
+  long n = strtol (text, &end, 10);
+  if (end == text || *end || errno || n < 1 || n > 7)
+    return false;
+  day = (int)(n % 7);
+  return true;
+}
+
+const char *const DAY_NAMES[] = { "周日", "周一", "周二", "周三",
+                                  "周四", "周五", "周六" };
+
+// 找出一组学生在指定周内共同空闲的节次
+int
+runFree (int argc, char *argv[])
 {
-  if (isStart)
+  vector<string> positional;
+  string ids, weeks;
+  int minFree = 0;
+  bool json = false;
+  unsigned threads = thread::hardware_concurrency ();
+  for (int i = 2; i < argc; ++i)
     {
-      switch (period)
+      string arg = argv[i];
+      if (arg == "--ids" && i + 1 < argc)
+        ids = argv[++i];
+      else if (arg == "--weeks" && i + 1 < argc)
+        weeks = argv[++i];
+      else if (arg == "--min" && i + 1 < argc)
+        minFree = atoi (argv[++i]);
+      else if (arg == "--json")
+        json = true;
+      else if (arg == "--jobs" && i + 1 < argc)
         {
-        case 1:
-          return "083000";
-        case 2:
-          return "092500";
-        case 3:
-          return "103000";
-        case 4:
-          return "112500";
-        case 5:
-          return "140000";
-        case 6:
-          return "145500";
-        case 7:
-          return "160000";
-        case 8:
-          return "165500";
-        case 9:
-          return "183000";
-        case 10:
-          return "192500";
-        case 11:
-          return "203000";
-        case 12:
-          return "212500";
-        default:
-          return "000000";
+          if (!parseJobs (argv[++i], threads))
+            return 1;
         }
+      else
+        positional.push_back (arg);
     }
-  else
+  int firstWeek = 1, lastWeek = MAX_WEEKS;
+  if (!weeks.empty () && !parseRange (weeks, firstWeek, lastWeek))
+    {
+      cerr << "无法解析周数范围 " << weeks << endl;
+      return 1;
+    }
+  if (positional.size () != 1)
+    {
+      printUsage ();
+      return 1;
+    }
+
+  vector<BatchJob> jobs;
+  vector<Schedule> scheds;
+  vector<bool> loaded;
+  string err;
+  unsigned long long t0 = monotonicNs ();
+  if (!loadScheduleSet (positional[0], threads, jobs, scheds, loaded, err))
+    {
+      cerr << err << endl;
+      return 1;
+    }
+  vector<Occupancy> occupancy;
+  map<string, size_t> index;
+  for (size_t i = 0; i < jobs.size (); ++i)
+    {
+      if (!loaded[i])
+        cerr << "警告: 无法载入 " << jobs[i].input << endl;
+      else if (index.insert (make_pair (jobs[i].name, occupancy.size ()))
+                   .second)
+        {
+          occupancy.push_back (Occupancy ());
+          buildOccupancy (scheds[i].courses, occupancy.back ());
+        }
+    }
+  FreeTimeIndex free;
+  free.build (occupancy);
+  double loadMs = (monotonicNs () - t0) / 1e6;
+
+  // --ids 为空时统计全部学生
+  vector<uint64_t> selection = free.emptySelection ();
+  vector<string> unknown;
+  size_t selected = ids.empty () ? free.size () : 0;
+  for (size_t pos = 0; !ids.empty () && pos <= ids.size ();)
     {
-      switch (period)
+      size_t comma = ids.find (',', pos);
+      if (comma == string::npos)
+        comma = ids.size ();
+      string id = ids.substr (pos, comma - pos);
+      pos = comma + 1;
+      map<string, size_t>::iterator it = index.find (id);
+      if (it == index.end ())
         {
-        case 1:
-          return "091500";
-        case 2:
-          return "101000";
-        case 3:
-          return "111500";
-        case 4:
-          return "121000";
-        case 5:
-          return "144500";
-        case 6:
-          return "154000";
-        case 7:
-          return "164500";
-        case 8:
-          return "174000";
-        case 9:
-          return "191500";
-        case 10:
-          return "201000";
-        case 11:
-          return "211500";
-        case 12:
-          return "221000";
-        default:
-          return "000000";
+          if (!id.empty ())
+            unknown.push_back (id);
+          continue;
         }
+      uint64_t bit = 1ULL << (it->second % 64);
+      if (!(selection[it->second / 64] & bit))
+        ++selected;
+      selection[it->second / 64] |= bit;
+    }
+  for (size_t i = 0; i < unknown.size (); ++i)
+    cerr << "警告: 没有学号 " << unknown[i] << " 的课表" << endl;
+  if (!ids.empty () && selected == 0)
+    {
+      // 否则每个格子都会以 0/0 的“全员空闲”列出
+      cerr << "--ids 中没有一个学号有课表" << endl;
+      return 1;
+    }
+  if (minFree < 1)
+    minFree = (int)selected;
+
+  t0 = monotonicNs ();
+  int counts[SLOT_COUNT];
+  free.countFree (firstWeek, lastWeek, ids.empty () ? NULL : &selection,
+                  counts);
+  double queryMs = (monotonicNs () - t0) / 1e6;
+
+  if (json)
+    {
+      writeFreeJson (cout, counts, minFree, selected, firstWeek, lastWeek,
+                     unknown);
+      return 0;
     }
+  cout << "第 " << firstWeek << "-" << lastWeek << " 周，" << selected
+       << " 名学生中至少 " << minFree << " 人空闲的节次：" << endl;
+  int shown = 0;
+  for (int slot = 0; slot < SLOT_COUNT; ++slot)
+    if (counts[slot] >= minFree)
+      {
+        cout << "  " << DAY_NAMES[slot / PERIODS_PER_DAY] << " 第 "
+             << slot % PERIODS_PER_DAY + 1 << " 节  " << counts[slot] << "/"
+             << selected << endl;
+        ++shown;
+      }
+  if (!shown)
+    cout << "  （没有）" << endl;
+  cout << fixed << setprecision (2) << "载入 " << loadMs << " ms，查询 "
+       << queryMs << " ms" << endl;
+  return 0;
 }
 
+// ---- 空教室 ----
+
+// 查询空教室或教室使用率。source 为索引文件、含 rooms.index 的批量输出
+// 目录，或者批量转换的输入（此时现场建立索引）
 int
-main (int argc, char *argv[])
+runRooms (int argc, char *argv[])
 {
-  ifstream file ("exp.html"); // 打开抓取的 HTML 文件
-  if (!file.is_open ())
+  vector<string> positional;
+  string building, weeks, periods;
+  int day = -1;
+  bool badDay = false;
+  for (int i = 2; i < argc; ++i)
     {
-      cerr << "无法打开 exp.html" << endl;
-      return 1; // 文件打开失败退出
+      string arg = argv[i];
+      if (arg == "--building" && i + 1 < argc)
+        building = argv[++i];
+      else if (arg == "--weeks" && i + 1 < argc)
+        weeks = argv[++i];
+      else if (arg == "--day" && i + 1 < argc)
+        badDay = !parseDay (argv[++i], day) || badDay;
+      else if (arg == "--periods" && i + 1 < argc)
+        periods = argv[++i];
+      else
+        positional.push_back (arg);
+    }
+  int firstWeek = 1, lastWeek = MAX_WEEKS;
+  int firstPeriod = 1, lastPeriod = PERIODS_PER_DAY;
+  if (positional.size () != 1 || badDay
+      || (!weeks.empty () && !parseRange (weeks, firstWeek, lastWeek))
+      || (!periods.empty () && !parseRange (periods, firstPeriod, lastPeriod))
+      || (!periods.empty () && day < 0))
+    {
+      printUsage ();
+      return 1;
     }
-  string content ((istreambuf_iterator<char> (file)),
-                  istreambuf_iterator<char> ()); // 读取全部内容
-  file.close ();                                 // 关闭文件
 
-  string colMark = "kbappTimetableDayColumnRoot"; // 定义每一列课表的标记
-  vector<string> dayHtmls;                        // 存储每一天的 HTML 片段
-  size_t lastPos = 0;                             // 上一次查找的位置
-  while (true)
+  const string &source = positional[0];
+  RoomIndex index;
+  string indexPath = isDirectory (source) ? joinPath (source, "rooms.index")
+                                          : source;
+  if (!index.load (indexPath))
     {
-      size_t pos = content.find (colMark, lastPos); // 查找列标记
-      if (pos == string::npos)
-        break;                                       // 找不到了则退出循环
-      size_t startDiv = content.rfind ("<div", pos); // 向上寻找 div 的开始
-      size_t nextPos = content.find (
-          colMark, pos + colMark.length ()); // 查找下一个列标记
-      if (nextPos == string::npos)
+      vector<BatchJob> jobs;
+      vector<Schedule> scheds;
+      vector<bool> loaded;
+      string err;
+      if (!loadScheduleSet (source, thread::hardware_concurrency (), jobs,
+                            scheds, loaded, err))
         {
-          nextPos
-              = content.find ("</div>\n", pos); // 若是最后一列，寻找闭合标签
-          if (nextPos == string::npos)
-            nextPos = content.length (); // 保守方案：截取到文件末尾
+          cerr << err << endl;
+          return 1;
         }
-      else
-        {
-          nextPos = content.rfind ("<div", nextPos); // 记录下一列 div 的起始
-        }
-      dayHtmls.push_back (
-          content.substr (startDiv, nextPos - startDiv)); // 截取该天的数据
-      lastPos = pos + colMark.length ();                  // 更新查找起点
-      if (dayHtmls.size () == 7)
-        break; // 抓够 7 天则强制退出
+      for (size_t i = 0; i < scheds.size (); ++i)
+        index.add (scheds[i].courses);
     }
 
-  vector<Course> courses;                 // 存储解析出的课程列表
-  string semesterInfo = "2025-2026 秋季"; // 默认值
-
-  // 尝试提取学期信息
-  regex semesterRegex ("selected=\"\">([^<]+学年 [^<]+)\\(当前\\)");
-  smatch sMatch;
-  if (regex_search (content, sMatch, semesterRegex))
+  unsigned long long t0 = monotonicNs ();
+  if (day >= 0)
     {
-      semesterInfo = sMatch[1].str ();
-      // 清理 "(当前)" 这种后缀
-      size_t cpos = semesterInfo.find ("(");
-      if (cpos != string::npos)
-        semesterInfo = semesterInfo.substr (0, cpos);
+      vector<string> rooms = index.freeRooms (building, firstWeek, lastWeek,
+                                              day, firstPeriod, lastPeriod);
+      double ms = (monotonicNs () - t0) / 1e6;
+      cout << "第 " << firstWeek << "-" << lastWeek << " 周 "
+           << DAY_NAMES[day] << " 第 " << firstPeriod << "-" << lastPeriod
+           << " 节的空教室（" << rooms.size () << " 间）：" << endl;
+      for (size_t i = 0; i < rooms.size (); ++i)
+        cout << "  " << rooms[i] << endl;
+      cout << fixed << setprecision (3) << "查询 " << ms << " ms" << endl;
+      return 0;
     }
 
-  for (int dayIndex = 0; dayIndex < (int)dayHtmls.size (); ++dayIndex)
-    {
-      string dayHtml = dayHtmls[dayIndex]; // 获取当天的 HTML
-      regex slotRegex ("<div([^>]+style=\"[^\"]*flex:\\s*(\\d+)[^\"]*\"[^>]*)"
-                       ">"); // 匹配课程格子的
-                             // flex 值
-      auto it = sregex_iterator (dayHtml.begin (), dayHtml.end (), slotRegex);
-      auto end = sregex_iterator ();
-
-      if (it != end)
-        ++it; // 跳过最外层的列容器 div
+  vector<RoomUsage> usage = index.usage (building, firstWeek, lastWeek);
+  double ms = (monotonicNs () - t0) / 1e6;
+  cout << "第 " << firstWeek << "-" << lastWeek << " 周教室使用率（"
+       << usage.size () << " 间，按节次 × 周计）：" << endl;
+  for (size_t i = 0; i < usage.size (); ++i)
+    cout << fixed << setprecision (1) << "  " << usage[i].room << "  "
+         << usage[i].busy << "/" << usage[i].total << "  "
+         << (usage[i].total ? 100.0 * usage[i].busy / usage[i].total : 0.0)
+         << "%" << endl;
+  cout << fixed << setprecision (3) << "查询 " << ms << " ms" << endl;
+  return 0;
+}
 
-      int currentPeriod = 1; // 当前节数计数器
-      for (; it != end; ++it)
-        {
-          smatch m = *it;
-          string attributes = m[1]; // 获取属性字符串
-          int flex = stoi (m[2]);   // 提取 flex 值（代表占用的节数）
-          bool isTopLevel
-              = (attributes.find ("class=") == string::npos
-                 || attributes.find ("kbappTimetableDayColumn")
-                        != string::
-                            npos); // 判断是否为顶层课程块（包含冲突容器和普通课程块）
-          if (!isTopLevel)
-            continue; // 非顶层块则跳过
-
-          // 提取当前块内部的 HTML 内容
-          size_t startPos = m.position () + m.length ();
-          size_t endPos = dayHtml.length ();
-          auto nextIt = it;
-          for (++nextIt; nextIt != end; ++nextIt)
-            {
-              string nextAttr = (*nextIt)[1];
-              if (nextAttr.find ("class=") == string::npos
-                  || nextAttr.find ("kbappTimetableDayColumn") != string::npos)
-                {
-                  endPos = (*nextIt).position (); // 确定当前块的结束位置
-                  break;
-                }
-            }
-          string innerHtml = dayHtml.substr (startPos, endPos - startPos);
+// ---- 常驻模式 ----
+// 常驻进程省掉每个任务的进程启动。协议如下，请求可以连续发送、不必等待
+// 响应；各任务由线程池并行处理，完成即写回，响应顺序可能与请求不同，
+// 用 id 对应：
+//   请求  JOB <id> <YYYY-MM-DD|-> <格式[,格式...]> <页面字节数>\n<页面>
+//   响应  OK <id> <课程数> <段数>\n 后接各段 <名称> <字节数>\n<内容>，
+//         依次为所请求的格式，最后一段 stats 为该任务的统计 JSON
+//         ERR <id> <原因>\n
+// 格式为 ics、ics-expand、csv、html。请求格式错误时回 ERR 并断开连接。
 
-          regex titleRegex ("class=\"title[^\"]*\">\\s*([\\s\\S]+?)\\s*</"
-                            "div>"); // 匹配课程标题
-          auto titleIt = sregex_iterator (innerHtml.begin (), innerHtml.end (),
-                                          titleRegex);
-          auto titleEnd = sregex_iterator ();
+#ifndef _WIN32
 
-          for (; titleIt != titleEnd; ++titleIt)
-            {
-              smatch tm = *titleIt;
-              Course c;
-              c.day = dayIndex;                       // 记录星期
-              c.startPeriod = currentPeriod;          // 记录起始节数
-              c.endPeriod = currentPeriod + flex - 1; // 计算结束节数
-              c.title = clean (tm[1]);                // 提取并清理标题
-
-              // 过滤掉非课程的页面干扰项
-              if (c.title == "我的应用" || c.title == "公告消息情况"
-                  || c.title == "学习日程"
-                  || c.title.find ("2026-") != string::npos)
-                continue;
+const size_t MAX_JOB_BYTES = 64 * 1024 * 1024;
+const unsigned MAX_WORKER_CONNECTIONS = 256; // 同时服务的连接数上限
 
-              size_t blockStart = tm.position () + tm.length ();
-              auto titleNext = titleIt;
-              ++titleNext;
-              size_t blockEnd = (titleNext == titleEnd)
-                                    ? innerHtml.length ()
-                                    : titleNext->position ();
-              string itemInfoHtml
-                  = innerHtml.substr (blockStart, blockEnd - blockStart);
-
-              regex infoRegex (
-                  "class=\"kbappTimetableCourseRenderCourseItemInfoText["
-                  "^\"]*\">\\s*([\\s\\S]+?)\\s*</div>"); // 匹配详情文字
-              auto infoIt = sregex_iterator (itemInfoHtml.begin (),
-                                             itemInfoHtml.end (), infoRegex);
-              bool firstInfo = true;
-              for (; infoIt != sregex_iterator (); ++infoIt)
-                {
-                  string info = clean ((*infoIt)[1]); // 清理信息文字
-                  if (info.empty ())
-                    continue;
-                  if (firstInfo)
-                    {
-                      // 1. 提取周数部分
-                      regex weekRegex ("([0-9\\-,]+周(\\((单|双)\\))?)");
-                      smatch wmatch;
-                      if (regex_search (info, wmatch, weekRegex))
-                        c.weekStr = wmatch.str ();
-                      else
-                        c.weekStr = "";
-
-                      c.weeks = parseWeeks (info);        // 解析周数数组
-                      c.location = formatLocation (info); // 提取地点
-
-                      // 2. 提取教师姓名
-                      // (从第一行中剔除周数和地点关键字后的部分)
-                      string teacher = info;
-                      if (!c.weekStr.empty ())
-                        {
-                          size_t wpos = teacher.find (c.weekStr);
-                          if (wpos != string::npos)
-                            teacher.erase (wpos, c.weekStr.length ());
-                        }
-                      size_t locKeyPos = teacher.find ("浑南校区");
-                      if (locKeyPos == string::npos)
-                        locKeyPos = teacher.find ("南湖校区");
-                      if (locKeyPos != string::npos)
-                        {
-                          teacher.erase (locKeyPos);
-                        }
-                      else if (!c.location.empty ())
-                        {
-                          size_t lpos = teacher.find (c.location);
-                          if (lpos != string::npos)
-                            teacher.erase (lpos, c.location.length ());
-                        }
-                      teacher = clean (teacher);
-                      if (!teacher.empty ())
-                        {
-                          if (!c.description.empty ())
-                            c.description += ",";
-                          c.description += teacher;
-                        }
-
-                      firstInfo = false;
-                    }
-                  else
-                    {
-                      if (!c.description.empty ())
-                        c.description += ",";
-                      c.description += info; // 拼接其他信息（通常是教师）
-                    }
-                }
-              if (!c.title.empty ())
-                {
-                  courses.push_back (c); // 加入课程列表
-                }
-            }
-          currentPeriod += flex; // 更新当前节数
+// 固定数目的工作线程与有界任务队列；队列满时 push 阻塞，读取请求的线程
+// 随之停止读取，客户端发送过快时由套接字缓冲区反压
+class JobPool
+{
+public:
+  JobPool (unsigned threads, size_t capacity)
+      : capacity_ (capacity), stopping_ (false)
+  {
+    for (unsigned i = 0; i < threads; ++i)
+      workers_.push_back (thread ([this] () { run (); }));
+  }
+
+  // 处理完队列中剩余的任务后返回
+  ~JobPool ()
+  {
+    {
+      lock_guard<mutex> lock (mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_all ();
+    for (size_t i = 0; i < workers_.size (); ++i)
+      workers_[i].join ();
+  }
+
+  void
+  push (const function<void ()> &job)
+  {
+    unique_lock<mutex> lock (mutex_);
+    space_.wait (lock, [this] () { return queue_.size () < capacity_; });
+    queue_.push_back (job);
+    ready_.notify_one ();
+  }
+
+private:
+  void
+  run ()
+  {
+    while (true)
+      {
+        function<void ()> job;
+        {
+          unique_lock<mutex> lock (mutex_);
+          ready_.wait (lock,
+                       [this] () { return stopping_ || !queue_.empty (); });
+          if (queue_.empty ())
+            return;
+          job = queue_.front ();
+          queue_.pop_front ();
         }
+        space_.notify_one ();
+        job ();
+      }
+  }
+
+  size_t capacity_;
+  bool stopping_;
+  deque<function<void ()> > queue_;
+  mutex mutex_;
+  condition_variable ready_;
+  condition_variable space_;
+  vector<thread> workers_;
+};
+
+// 连接数计数。达到上限时接受连接的线程等待，新连接留在监听队列里，
+// 不会每条连接一个线程地把描述符耗尽
+class ConnectionSlots
+{
+public:
+  explicit ConnectionSlots (unsigned limit) : limit_ (limit), used_ (0) {}
+
+  void
+  acquire ()
+  {
+    unique_lock<mutex> lock (mutex_);
+    freed_.wait (lock, [this] () { return used_ < limit_; });
+    ++used_;
+  }
+
+  void
+  release ()
+  {
+    {
+      lock_guard<mutex> lock (mutex_);
+      --used_;
     }
+    freed_.notify_one ();
+  }
+
+private:
+  unsigned limit_;
+  unsigned used_;
+  mutex mutex_;
+  condition_variable freed_;
+};
+
+// 一条连接：套接字，或 --serve - 时的标准输入/输出
+struct WorkerConnection
+{
+  int inFd;
+  int outFd;
+  mutex writeMutex;
+  bool broken; // 写失败后不再写
+
+  WorkerConnection (int in, int out) : inFd (in), outFd (out), broken (false)
+  {
+  }
+  ~WorkerConnection ()
+  {
+    if (inFd > 2)
+      close (inFd);
+    if (outFd > 2 && outFd != inFd)
+      close (outFd);
+  }
+
+  // 多个工作线程共用一条连接，整条响应一次写完
+  void
+  send (const string &s)
+  {
+    lock_guard<mutex> lock (writeMutex);
+    const char *p = s.data ();
+    size_t n = s.size ();
+    while (n > 0 && !broken)
+      {
+        ssize_t w = write (outFd, p, n);
+        if (w < 0 && errno == EINTR)
+          continue;
+        if (w <= 0)
+          broken = true;
+        else
+          {
+            p += w;
+            n -= w;
+          }
+      }
+  }
+};
 
-  cout << "成功提取 " << courses.size () << " 门课程。" << endl;
+// 带缓冲地从 fd 读取请求行和页面
+class FdReader
+{
+public:
+  explicit FdReader (int fd) : fd_ (fd), buf_ (64 * 1024), pos_ (0), len_ (0)
+  {
+  }
+
+  // 读一行（不含 '\n'），超过 maxLen 或输入结束时返回 false
+  bool
+  readLine (string &line, size_t maxLen)
+  {
+    line.clear ();
+    while (true)
+      {
+        if (pos_ == len_ && !fill ())
+          return false;
+        const char *p = &buf_[pos_];
+        const char *nl = (const char *)memchr (p, '\n', len_ - pos_);
+        size_t n = nl ? nl - p : len_ - pos_;
+        if (line.size () + n > maxLen)
+          return false;
+        line.append (p, n);
+        pos_ += n;
+        if (nl)
+          {
+            ++pos_;
+            return true;
+          }
+      }
+  }
+
+  bool
+  readExact (string &out, size_t size)
+  {
+    out.resize (size);
+    size_t got = 0;
+    while (got < size)
+      {
+        if (pos_ == len_ && !fill ())
+          return false;
+        size_t n = min (size - got, len_ - pos_);
+        memcpy (&out[got], &buf_[pos_], n);
+        pos_ += n;
+        got += n;
+      }
+    return true;
+  }
+
+private:
+  bool
+  fill ()
+  {
+    while (true)
+      {
+        ssize_t n = read (fd_, &buf_[0], buf_.size ());
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n <= 0)
+          return false;
+        pos_ = 0;
+        len_ = n;
+        return true;
+      }
+  }
+
+  int fd_;
+  vector<char> buf_;
+  size_t pos_;
+  size_t len_;
+};
 
+// 一个已读完页面的任务
+struct WorkerJob
+{
+  string id;
   string startSunday;
-  if (argc > 1)
+  vector<string> formats;
+  string html;
+};
+
+// 处理一个任务，返回完整的响应
+string
+runWorkerJob (const WorkerJob &job)
+{
+  RunStats stats;
+  unsigned long long t0 = monotonicNs ();
+  for (size_t i = 0; i < job.formats.size (); ++i)
+    if (job.formats[i].compare (0, 3, "ics") == 0
+        && !SemesterCalendar (job.startSunday).valid ())
+      return "ERR " + job.id + " 无法解析日期 " + job.startSunday + "\n";
+
+  Schedule sched = parseSchedule (job.html.data (), job.html.size (), &stats);
+  countSchedule (&stats, sched, false);
+  vector<pair<string, string> > parts;
+  for (size_t i = 0; i < job.formats.size (); ++i)
     {
-      startSunday = argv[1]; // 从命令行获取日期
-      cout << "使用命令行参数日期: " << startSunday << endl;
+      const string &f = job.formats[i];
+      ostringstream out;
+      Stage stage = f == "csv"    ? STAGE_CSV
+                    : f == "html" ? STAGE_HTML
+                                  : STAGE_ICS;
+      StageTimer timer (&stats, stage);
+      if (f == "csv")
+        writeCsv (out, sched.courses);
+      else if (f == "html")
+        out << renderOldHtml (sched.courses, sched.semesterInfo);
+      else
+        stats.events += writeIcs (out, sched.courses, job.startSunday,
+                                  f == "ics-expand");
+      parts.push_back (make_pair (f, out.str ()));
+      timer.stop (parts.back ().second.size ());
     }
-  else
+  ostringstream json;
+  stats.writeJson (json, (monotonicNs () - t0) / 1e9, 1);
+  parts.push_back (make_pair (string ("stats"), json.str ()));
+
+  string resp = "OK " + job.id + " " + to_string (sched.courses.size ())
+                + " " + to_string (parts.size ()) + "\n";
+  for (size_t i = 0; i < parts.size (); ++i)
+    resp += parts[i].first + " " + to_string (parts[i].second.size ()) + "\n"
+            + parts[i].second;
+  return resp;
+}
+
+// 解析请求行，出错时 err 为原因
+bool
+parseJobHeader (const string &line, WorkerJob &job, size_t &size, string &err)
+{
+  istringstream in (line);
+  string verb, formats, sizeText;
+  job.id = "-";
+  if (!(in >> verb >> job.id >> job.startSunday >> formats >> sizeText)
+      || verb != "JOB")
     {
-      cout << "请输入学期第一周周日的日期 (格式 YYYY-MM-DD): ";
-      if (!(cin >> startSunday))
-        startSunday = "2026-03-01"; // 默认备份日期
+      err = "请求格式错误";
+      return false;
     }
-
-  ofstream ics ("schedule.ics"); // 创建输出文件
-  ics << "BEGIN:VCALENDAR\nVERSION:2.0\nPRODID:-//NEU Course Table//CN\n";
-  int totalEvents = 0;
-  for (const auto &c : courses)
+  char *end;
+  unsigned long long n = strtoull (sizeText.c_str (), &end, 10);
+  if (*end || n > MAX_JOB_BYTES)
+    {
+      err = "页面大小无效";
+      return false;
+    }
+  size = (size_t)n;
+  job.formats.clear ();
+  for (size_t pos = 0; pos <= formats.size ();)
     {
-      for (int week : c.weeks)
+      size_t comma = formats.find (',', pos);
+      if (comma == string::npos)
+        comma = formats.size ();
+      string f = formats.substr (pos, comma - pos);
+      if (f != "ics" && f != "ics-expand" && f != "csv" && f != "html")
         {
-          string date
-              = addDays (startSunday, c.day + (week - 1) * 7); // 计算具体日期
-          string startTime = getTime (c.startPeriod, true);    // 获取起始时间
-          string endTime = getTime (c.endPeriod, false);       // 获取结束时间
-          ics << "BEGIN:VEVENT\n";
-          ics << "SUMMARY:" << c.title << "\n";           // 写入标题
-          ics << "LOCATION:" << c.location << "\n";       // 写入地点
-          ics << "DESCRIPTION:" << c.description << "\n"; // 写入详情
-          ics << "DTSTART:" << date << "T" << startTime
-              << "\n";                                       // 写入开始时间
-          ics << "DTEND:" << date << "T" << endTime << "\n"; // 写入结束时间
-          ics << "END:VEVENT\n";
-          totalEvents++; // 计数
+          err = "未知格式 " + f;
+          return false;
         }
+      job.formats.push_back (f);
+      pos = comma + 1;
     }
-  ics << "END:VCALENDAR\n";
-  ics.close (); // 关闭文件
-  cout << "生成完成，保存在 schedule.ics" << endl;
+  return true;
+}
 
-  // 生成 CSV 课程表
-  ofstream csv ("courses.csv");
-  csv << "课程名称,星期,开始节数,结束节数,老师,地点,周数\n";
-  for (const auto &c : courses)
+// 读取一条连接上的请求，交给线程池；连接在最后一个任务写回后关闭
+void
+serveConnection (shared_ptr<WorkerConnection> conn, JobPool &pool)
+{
+  FdReader in (conn->inFd);
+  string line;
+  while (in.readLine (line, 4096))
     {
-      if (c.weeks.empty ())
+      if (line.empty () || line == "\r")
         continue;
+      shared_ptr<WorkerJob> job (new WorkerJob);
+      size_t size;
+      string err;
+      if (!parseJobHeader (line, *job, size, err))
+        {
+          conn->send ("ERR " + job->id + " " + err + "\n");
+          return; // 无法确定页面在哪里结束，不再继续读
+        }
+      if (!in.readExact (job->html, size))
+        return;
+      pool.push ([conn, job] () {
+        string resp;
+        try
+          {
+            resp = runWorkerJob (*job);
+          }
+        catch (const exception &e)
+          {
+            resp = "ERR " + job->id + " " + e.what () + "\n";
+          }
+        conn->send (resp);
+      });
+    }
+}
+
+string workerSocketPath; // 退出时删除
 
-      // 复制并排序周数
-      vector<int> sortedWeeks = c.weeks;
-      sort (sortedWeeks.begin (), sortedWeeks.end ());
+void
+removeWorkerSocket (int)
+{
+  unlink (workerSocketPath.c_str ());
+  _exit (0);
+}
 
-      // 转换星期：0(周日)->7, 1(周一)->1 ... 6(周六)->6
-      int displayDay = (c.day == 0) ? 7 : c.day;
-      string teacher = c.description;
-      if (teacher.empty ())
-        teacher = "无";
-      string location = c.location.empty () ? "无" : c.location;
+int
+runWorker (int argc, char *argv[])
+{
+  string target;
+  unsigned threads = thread::hardware_concurrency ();
+  for (int i = 2; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--jobs" && i + 1 < argc)
+        {
+          if (!parseJobs (argv[++i], threads))
+            return 1;
+        }
+      else if (target.empty ())
+        target = arg;
+      else
+        {
+          printUsage ();
+          return 1;
+        }
+    }
+  if (target.empty ())
+    {
+      printUsage ();
+      return 1;
+    }
+  if (threads == 0)
+    threads = 1;
+  signal (SIGPIPE, SIG_IGN); // 客户端提前断开只影响该连接
 
-      // 查找连续的周数段
-      int startW = sortedWeeks[0];
-      int prevW = sortedWeeks[0];
+  if (target == "-")
+    {
+      // 标准输入/输出上的单条连接，输入结束并写完所有响应后退出
+      JobPool pool (threads, threads * 4);
+      serveConnection (make_shared<WorkerConnection> (0, 1), pool);
+      return 0;
+    }
 
-      for (size_t i = 1; i <= sortedWeeks.size (); ++i)
+  sockaddr_un addr;
+  memset (&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (target.size () >= sizeof addr.sun_path)
+    {
+      cerr << "套接字路径过长: " << target << endl;
+      return 1;
+    }
+  memcpy (addr.sun_path, target.c_str (), target.size ());
+  int listenFd = socket (AF_UNIX, SOCK_STREAM, 0);
+  unlink (target.c_str ()); // 上次异常退出留下的套接字文件
+  if (listenFd < 0 || bind (listenFd, (sockaddr *)&addr, sizeof addr) < 0
+      || listen (listenFd, 128) < 0)
+    {
+      cerr << "无法监听 " << target << ": " << strerror (errno) << endl;
+      return 1;
+    }
+  workerSocketPath = target;
+  signal (SIGINT, removeWorkerSocket);
+  signal (SIGTERM, removeWorkerSocket);
+  cerr << "常驻模式已启动: " << target << "，线程数 " << threads << endl;
+
+  JobPool pool (threads, threads * 4);
+  ConnectionSlots slots (MAX_WORKER_CONNECTIONS);
+  bool exhausted = false;
+  while (true)
+    {
+      slots.acquire ();
+      int fd = accept (listenFd, NULL, NULL);
+      if (fd < 0)
         {
-          if (i < sortedWeeks.size () && sortedWeeks[i] == prevW + 1)
-            {
-              prevW = sortedWeeks[i];
-            }
-          else
+          slots.release ();
+          if (errno == EINTR || errno == ECONNABORTED)
+            continue;
+          if (errno == EMFILE || errno == ENFILE)
             {
-              // 发现一段连续周落幕，生成一条记录
-              string rangeStr;
-              if (startW == prevW)
-                {
-                  rangeStr = to_string (startW) + "周";
-                }
-              else
-                {
-                  rangeStr
-                      = to_string (startW) + "-" + to_string (prevW) + "周";
-                }
-
-              csv << csvQuote (c.title) << "," << displayDay << ","
-                  << c.startPeriod << "," << c.endPeriod << ","
-                  << csvQuote (teacher) << "," << csvQuote (location) << ","
-                  << csvQuote (rangeStr) << "\n";
-
-              if (i < sortedWeeks.size ())
-                {
-                  startW = sortedWeeks[i];
-                  prevW = sortedWeeks[i];
-                }
+              // 等已有连接关闭后再接受，不空转
+              if (!exhausted)
+                cerr << "accept 失败: " << strerror (errno) << endl;
+              exhausted = true;
+              this_thread::sleep_for (chrono::milliseconds (100));
+              continue;
             }
+          cerr << "accept 失败: " << strerror (errno) << endl;
+          return 1;
         }
+      exhausted = false;
+      shared_ptr<WorkerConnection> conn
+          = make_shared<WorkerConnection> (fd, fd);
+      thread ([conn, &pool, &slots] () {
+        serveConnection (conn, pool);
+        slots.release ();
+      }).detach ();
     }
-  csv.close ();
-  cout << "CSV 课程表已生成: courses.csv" << endl;
+}
 
-#ifdef _WIN32
-  system ("if not exist eams mkdir eams");
 #else
-  system ("mkdir -p eams");
+
+int
+runWorker (int, char *[])
+{
+  cerr << "Windows 上不支持常驻模式" << endl;
+  return 1;
+}
+
 #endif
 
-  // 生成旧版样式的 HTML 课表 (同步生成本地预览和 EAMS 模拟路径)
-  ofstream html ("exp_old.html");
-  ofstream html_eams ("eams/courseTableForStd.action");
-
-  string h_header = R"(<!DOCTYPE html>
-<html>
-<head>
-    <meta http-equiv="content-type" content="text/html; charset=utf-8">
-    <meta http-equiv="X-UA-Compatible" content="IE=edge">
-    <title>我的课表 (旧系统还原)</title>
-    <link href="/eams/static/themes/default/css/semesterCalendar.css" rel="stylesheet" type="text/css">
-    <link href="/eams/static/scripts/font-awesome/css/font-awesome.min.css" rel="stylesheet" type="text/css">
-    <link href="/eams/static/themes/default/css/jquery-ui.css" rel="stylesheet" type="text/css">
-    <link href="/eams/static/themes/default/css/global.css" rel="stylesheet" type="text/css">
-    <style>
-        .gridtable { border-collapse: collapse; width: 100%; border: 1px solid #000; background: white; table-layout: fixed; text-align: center; border-spacing: 0px;}
-        .gridtable th { background-color: #DEEDF7; border: 1px solid #000; font-size: 13px; font-weight: normal; height: 30px; }
-        .gridtable td { border: 1px solid #000; text-align: center; padding: 2px; font-size: 11px; vertical-align: middle; }
-        .infoTitle { background-color: rgb(148, 174, 243); cursor: pointer; color: black; }
-        .period-label { background-color: #DEEDF7; font-weight: normal; width: 80px; }
-        #main-top { height: 50px; background-color: #2b70c1; color: white; display: flex; align-items: center; justify-content: space-between; padding: 0 20px; }
-        #main-top .logo img { height: 35px; }
-        .system-name { font-size: 18px; font-weight: bold; margin-left: 10px; }
-        .personal-list ul { list-style: none; display: flex; margin: 0; padding: 0; }
-        .personal-list li { margin-left: 20px; font-size: 14px; }
-        .personal-list a { color: white; text-decoration: none; }
-        .main-nav { background-color: #f1f1f1; border-bottom: 2px solid #2b70c1; padding: 5px 20px; }
-        .main-nav ul { list-style: none; display: flex; margin: 0; padding: 0; }
-        .main-nav li { margin-right: 20px; padding: 5px 10px; }
-        .main-nav li.active { background-color: #2b70c1; }
-        .main-nav li.active a { color: white; }
-        .main-nav a { text-decoration: none; color: #333; font-weight: bold; }
-        #menu_panel { background-color: #f9f9f9; border-right: 1px solid #ddd; height: 100%; }
-        .menu { list-style: none; padding: 0; margin: 0; }
-        .first_menu { display: block; padding: 10px; background: #e9e9e9; border-bottom: 1px solid #ddd; color: #333; text-decoration: none; font-weight: bold; }
-        .acitem { list-style: none; padding: 0; margin: 0; }
-        .acitem li { padding: 5px 20px; border-bottom: 1px split #eee; }
-        .acitem li.current { background-color: #d9e8fb; border-left: 4px solid #2b70c1; }
-        .acitem a { text-decoration: none; color: #666; font-size: 13px; }
-    </style>
-</head>
-<body class="main_body">
-    <div id="main-top">
-        <div style="display:flex; align-items:center;">
-            <div class="logo"><img src="/eams/static/images/logo.png"></div>
-            <div class="system-name">教务管理系统</div>
-        </div>
-        <div class="personal-list">
-            <ul>
-                <li><a href="#"><span class="fa fa-user"></span> 学生用户</a></li>
-                <li><a href="#"><span class="fa fa-question-circle"></span> 帮助</a></li>
-                <li><a href="#"><span class="fa fa-sign-out"></span> 退出</a></li>
-            </ul>
-        </div>
-    </div>
-    <div class="main-nav">
-        <ul>
-            <li class="active"><a href="#"><span class="fa fa-home"></span> 首页</a></li>
-            <li><a href="#">可用资源查询</a></li>
-            <li><a href="#">公共课表查询</a></li>
-        </ul>
-    </div>
-
-    <table style="width:100%; height: calc(100vh - 100px); border-collapse: collapse;">
-        <tr>
-            <td valign="top" style="width: 200px; background: #f9f9f9; border-right: 1px solid #ccc;">
-                <div id="menu_panel">
-                    <ul class="menu">
-                        <li>
-                            <a class="first_menu" href="#"><span class="fa fa-dashboard"></span> 我的</a>
-                            <ul class="acitem">
-                                <li><a href="#">学籍信息</a></li>
-                                <li><a href="#">培养计划</a></li>
-                                <li class="current"><a href="#">我的课表</a></li>
-                                <li><a href="#">选课</a></li>
-                                <li><a href="#">我的考试</a></li>
-                                <li><a href="#">我的成绩</a></li>
-                            </ul>
-                        </li>
-                    </ul>
-                </div>
-            </td>
-            <td valign="top" style="padding: 10px;">
-                <div id="main">
-                    <div class="toolbar">
-                        <div class="toolbar-title"><span class="fa fa-calendar"></span> <strong>我的课表</strong></div>
-                        <div class="toolbar-line"><hr color="#AED0EA"></div>
-                    </div>
-                    
-                    <div style="background: #DEEDF7; border: 1px solid #AED0EA; padding: 5px; margin-bottom: 10px; font-weight: bold;">
-                        课表类型: 学生课表 | 
-                        选择教学周: 全部 | 
-                        学年学期: )";
-
-  string h_middle = R"(
-                        <button style="float:right;">切换学期</button>
-                    </div>
-
-                    <div align="center">
-                        <pre style="font-size: 12px; color: #666; margin: 5px;">课表格式说明：教师姓名 课程名称(序号) (第n周-第m周,教室)</pre>
-                        <table id="manualArrangeCourseTable" class="gridtable" border="1">
-                            <caption>学生课表说明</caption>
-                            <thead>
-                                <tr>
-                                    <th style="width:80px;">节次/周次</th>
-                                    <th id="day1">星期日</th>
-                                    <th id="day2">星期一</th>
-                                    <th id="day3">星期二</th>
-                                    <th id="day4">星期三</th>
-                                    <th id="day5">星期四</th>
-                                    <th id="day6">星期五</th>
-                                    <th id="day7">星期六</th>
-                                </tr>
-                            </thead>
-                            <tbody>)";
-
-  stringstream t_body;
-  vector<Course *> cgrid[13][7];
-  for (auto &c : courses)
-    {
-      if (c.day >= 0 && c.day < 7 && c.startPeriod >= 1 && c.startPeriod <= 12)
-        cgrid[c.startPeriod][c.day].push_back (&c);
-    }
-
-  bool occupied[13][7] = { false };
-  const char *pNames[]
-      = { "",        " 第一节",   " 第二节",  " 第三节", " 第四节",
-          " 第五节", " 第六节",   " 第七节",  " 第八节", " 第九节",
-          " 第十节", " 第十一节", " 第十二节" };
-
-  for (int p = 1; p <= 12; ++p)
-    {
-      t_body << "<tr>";
-      t_body << "<td class='period-label'>" << pNames[p] << "</td>";
-
-      for (int d = 0; d < 7; ++d)
-        {
-          if (occupied[p][d])
-            continue;
+// ---- 监视模式 ----
+// 用 inotify 监视输入文件或目录。页面写完或改名到位后先等待一小段时间，
+// 期间再有改动就重新计时，连续多次保存只转换一次。转换沿用批量模式的
+// convertJob：内容没变的页面不重新解析，输出文件都以改名方式替换。
 
-          if (cgrid[p][d].empty ())
-            {
-              t_body << "<td style='background-color: #ffffff;'></td>";
+#ifdef __linux__
+
+// 监视的目录与待转换的页面
+class InputWatcher
+{
+public:
+  InputWatcher (const string &source, bool directory)
+      : source_ (source), directory_ (directory), fd_ (-1)
+  {
+  }
+  ~InputWatcher ()
+  {
+    if (fd_ >= 0)
+      close (fd_);
+  }
+
+  int
+  fd () const
+  {
+    return fd_;
+  }
+
+  // 开始监视，并把已有的页面都列为待转换
+  bool
+  open (string &err)
+  {
+    fd_ = inotify_init1 (IN_CLOEXEC | IN_NONBLOCK);
+    if (fd_ < 0)
+      {
+        err = string ("inotify 初始化失败: ") + strerror (errno);
+        return false;
+      }
+    string dir = directory_ ? source_ : parentDir (source_);
+    if (!watch (dir, ""))
+      {
+        err = "无法监视 " + dir + ": " + strerror (errno);
+        return false;
+      }
+    if (directory_)
+      {
+        vector<string> names = listDirectory (source_);
+        for (size_t i = 0; i < names.size (); ++i)
+          if (isDirectory (joinPath (source_, names[i])))
+            watch (joinPath (source_, names[i]), names[i]);
+      }
+    rescan ();
+    return true;
+  }
+
+  // 读出已到达的事件，有页面改动时返回 true
+  bool
+  readEvents ()
+  {
+    bool changed = false;
+    alignas (inotify_event) char buf[16 * 1024];
+    while (true)
+      {
+        ssize_t n = read (fd_, buf, sizeof buf);
+        if (n <= 0)
+          return changed;
+        for (char *p = buf; p < buf + n;)
+          {
+            const inotify_event *ev = (const inotify_event *)p;
+            p += sizeof (inotify_event) + ev->len;
+            if (ev->mask & IN_Q_OVERFLOW)
+              {
+                rescan (); // 丢了事件，全部重新检查一遍
+                changed = true;
+                continue;
+              }
+            map<int, string>::iterator it = dirs_.find (ev->wd);
+            if (it == dirs_.end ())
               continue;
-            }
+            if (ev->mask & IN_IGNORED)
+              {
+                dirs_.erase (it);
+                continue;
+              }
+            if (ev->len && handle (it->second, ev->name, ev->mask))
+              changed = true;
+          }
+      }
+  }
+
+  // 取出待转换的页面
+  vector<BatchJob>
+  takePending ()
+  {
+    vector<BatchJob> jobs;
+    for (map<string, BatchJob>::iterator it = pending_.begin ();
+         it != pending_.end (); ++it)
+      jobs.push_back (it->second);
+    pending_.clear ();
+    return jobs;
+  }
+
+private:
+  static string
+  parentDir (const string &path)
+  {
+    size_t slash = path.find_last_of ('/');
+    if (slash == string::npos)
+      return ".";
+    return slash == 0 ? "/" : path.substr (0, slash);
+  }
+
+  bool
+  watch (const string &dir, const string &name)
+  {
+    int wd = inotify_add_watch (fd_, dir.c_str (),
+                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE
+                                    | IN_ONLYDIR);
+    if (wd < 0)
+      return false;
+    dirs_[wd] = name;
+    return true;
+  }
+
+  void
+  add (const string &input, const string &name)
+  {
+    BatchJob job;
+    job.input = input;
+    job.name = name;
+    pending_[name] = job;
+  }
+
+  void
+  rescan ()
+  {
+    if (!directory_)
+      {
+        if (isRegularFile (source_))
+          add (source_, "");
+        return;
+      }
+    vector<BatchJob> jobs;
+    string err;
+    collectJobs (source_, jobs, err);
+    for (size_t i = 0; i < jobs.size (); ++i)
+      pending_[jobs[i].name] = jobs[i];
+  }
+
+  // sub 为事件所在的子目录名，监视的根目录为空
+  bool
+  handle (const string &sub, const string &name, uint32_t mask)
+  {
+    if (!directory_)
+      {
+        size_t slash = source_.find_last_of ('/');
+        string base = slash == string::npos ? source_
+                                            : source_.substr (slash + 1);
+        if (name != base || (mask & IN_ISDIR) || (mask & IN_CREATE))
+          return false;
+        add (source_, "");
+        return true;
+      }
+    if (sub.empty () && (mask & IN_ISDIR))
+      {
+        // 新建或移入的学生目录，里面可能已经有 exp.html
+        string path = joinPath (source_, name);
+        watch (path, name);
+        if (!isRegularFile (joinPath (path, "exp.html")))
+          return false;
+        add (joinPath (path, "exp.html"), name);
+        return true;
+      }
+    if (mask & (IN_CREATE | IN_ISDIR))
+      return false; // 文件创建后还会有写完的事件
+    if (sub.empty () && hasSuffix (name, ".html"))
+      add (joinPath (source_, name), name.substr (0, name.size () - 5));
+    else if (!sub.empty () && name == "exp.html")
+      add (joinPath (joinPath (source_, sub), name), sub);
+    else
+      return false;
+    return true;
+  }
+
+  string source_;
+  bool directory_;
+  int fd_;
+  map<int, string> dirs_;         // 监视描述符到子目录名
+  map<string, BatchJob> pending_; // 以输出子目录名去重
+};
 
-          int mEnd = p;
-          for (auto *cptr : cgrid[p][d])
-            {
-              if (cptr->endPeriod > mEnd)
-                mEnd = cptr->endPeriod;
-            }
-          if (mEnd > 12)
-            mEnd = 12;
+int
+runWatch (int argc, char *argv[])
+{
+  vector<string> positional;
+  CommandOptions opts;
+  unsigned threads = thread::hardware_concurrency ();
+  int debounceMs = 100;
+  for (int i = 2; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--jobs" && i + 1 < argc)
+        {
+          if (!parseJobs (argv[++i], threads))
+            return 1;
+        }
+      else if (arg == "--debounce" && i + 1 < argc)
+        debounceMs = atoi (argv[++i]);
+      else if (!opts.parse (arg))
+        positional.push_back (arg);
+    }
+  if (positional.size () != 3 || debounceMs < 0)
+    {
+      printUsage ();
+      return 1;
+    }
+  if (threads == 0)
+    threads = 1;
+  const string &source = positional[0];
+  const string &outRoot = positional[1];
+  const string &startSunday = positional[2];
+  if (!SemesterCalendar (startSunday).valid ())
+    {
+      cerr << "无法解析日期 " << startSunday << endl;
+      return 1;
+    }
+  if (!makeDirs (outRoot))
+    {
+      cerr << "无法创建输出目录 " << outRoot << endl;
+      return 1;
+    }
 
-          int rowspan = mEnd - p + 1;
+  InputWatcher watcher (source, isDirectory (source));
+  string err;
+  if (!watcher.open (err))
+    {
+      cerr << err << endl;
+      return 1;
+    }
+  cout << "正在监视 " << source << "，输出到 " << outRoot
+       << "，按 Ctrl+C 退出" << endl;
 
-          string tAttr;
-          for (size_t i = 0; i < cgrid[p][d].size (); ++i)
-            {
-              Course *cptr = cgrid[p][d][i];
-              if (i > 0)
-                tAttr += "; ";
-              tAttr += cptr->title + " (" + cptr->description + "); ("
-                       + cptr->weekStr + ", " + cptr->location + ")";
-            }
+  // 启动时先把已有的页面转换一遍，不必等待
+  unsigned long long deadline = monotonicNs ();
+  while (true)
+    {
+      int timeout = -1;
+      if (deadline)
+        {
+          unsigned long long now = monotonicNs ();
+          timeout = deadline > now ? (int)((deadline - now) / 1000000 + 1) : 0;
+        }
+      pollfd pfd;
+      pfd.fd = watcher.fd ();
+      pfd.events = POLLIN;
+      int ready = poll (&pfd, 1, timeout);
+      if (ready < 0 && errno != EINTR)
+        {
+          cerr << "poll 失败: " << strerror (errno) << endl;
+          return 1;
+        }
+      if (ready > 0)
+        {
+          if (watcher.readEvents ())
+            deadline = monotonicNs () + debounceMs * 1000000ULL;
+          continue;
+        }
+      if (!deadline || monotonicNs () < deadline)
+        continue;
+      deadline = 0;
+
+      vector<BatchJob> jobs = watcher.takePending ();
+      vector<BatchResult> results (jobs.size ());
+      unsigned long long t0 = monotonicNs ();
+      runWorkStealing (jobs.size (), threads, [&] (size_t i) {
+        convertJob (jobs[i], outRoot, startSunday, opts, results[i]);
+      });
+      double ms = (monotonicNs () - t0) / 1e6;
+
+      RunStats total;
+      size_t skipCount = 0;
+      for (size_t i = 0; i < jobs.size (); ++i)
+        {
+          const BatchResult &r = results[i];
+          if (!r.ok)
+            cerr << "失败: " << r.error << endl;
+          else if (r.skipped)
+            ++skipCount;
+          else
+            cout << "已更新 " << jobs[i].input << "：" << r.courses
+                 << " 门课程" << endl;
+          total.merge (r.stats);
+        }
+      cout << fixed << setprecision (1) << "转换 " << jobs.size ()
+           << " 个页面（" << skipCount << " 个未变化），耗时 " << ms << " ms"
+           << endl;
+      if (opts.stats)
+        opts.writeStats (total, ms / 1e3, threads);
+    }
+}
 
-          t_body << "<td class='infoTitle' rowspan='" << rowspan << "' title='"
-                 << escapeHtml (tAttr) << "'>";
-          t_body << "<div class='course-box'>";
+#else
 
-          for (size_t i = 0; i < cgrid[p][d].size (); ++i)
-            {
-              Course *cptr = cgrid[p][d][i];
-              t_body << cptr->title << "<br>(" << cptr->description << ")";
-              t_body << "<br>(" << cptr->weekStr << ", " << cptr->location
-                     << ")";
-              if (i < cgrid[p][d].size () - 1)
-                t_body << "<br>---<br>";
-            }
+int
+runWatch (int, char *[])
+{
+  cerr << "监视模式仅支持 Linux" << endl;
+  return 1;
+}
 
-          t_body << "</div></td>";
+#endif
 
-          for (int r = p; r <= mEnd; ++r)
-            occupied[r][d] = true;
-        }
-      t_body << "</tr>";
-    }
-
-  string h_footer = R"(                            </tbody>
-                        </table>
-                    </div>
-                </div>
-            </td>
-        </tr>
-    </table>
-</body>
-</html>)";
-
-  string final_html
-      = h_header + semesterInfo + h_middle + t_body.str () + h_footer;
-  html << final_html;
-  html_eams << final_html;
-
-  // 新增：模拟 Wakeup/小艾等常用的数据接口请求，直接返回完整 HTML
-  ofstream html_data ("eams/courseTableForStd!courseTable.action");
-  html_data << final_html;
-  html_data.close ();
-
-  html.close ();
-  html_eams.close ();
+int
+main (int argc, char *argv[])
+{
+  if (argc > 1 && string (argv[1]) == "--batch")
+    return runBatch (argc, argv);
+  if (argc > 1 && string (argv[1]) == "--pipe")
+    return runPipe (argc, argv);
+  if (argc > 1 && string (argv[1]) == "--serve")
+    return runWorker (argc, argv);
+  if (argc > 1 && string (argv[1]) == "--watch")
+    return runWatch (argc, argv);
+  if (argc > 1 && string (argv[1]) == "--free")
+    return runFree (argc, argv);
+  if (argc > 1 && string (argv[1]) == "--rooms")
+    return runRooms (argc, argv);
+  if (argc > 1 && (string (argv[1]) == "--help" || string (argv[1]) == "-h"))
+    {
+      printUsage ();
+      return 0;
+    }
+
+  CommandOptions opts;
+  vector<string> positional;
+  for (int i = 1; i < argc; ++i)
+    if (!opts.parse (argv[i]))
+      positional.push_back (argv[i]);
+
+  // 打开抓取的 HTML 文件；内容没变时直接取用上次的解析结果
+  RunStats runStats;
+  RunStats *stats = opts.stats ? &runStats : NULL;
+  unsigned long long t0 = monotonicNs ();
+  ScheduleCache cache;
+  bool hit, dirty;
+  size_t bytes;
+  string err;
+  if (!loadSchedule ("exp.html", "schedule.cache", opts.useCache, cache, hit,
+                     dirty, bytes, err, stats))
+    {
+      cerr << err << endl;
+      return 1; // 文件打开失败退出
+    }
+  if (dirty)
+    writeScheduleCache ("schedule.cache", cache, stats);
+  const Schedule &sched = cache.sched;
+  countSchedule (stats, sched, hit);
+  unsigned long long loadNs = monotonicNs () - t0;
+  cout << "成功提取 " << sched.courses.size () << " 门课程。" << endl;
+
+  string startSunday;
+  if (!positional.empty ())
+    {
+      startSunday = positional[0]; // 从命令行获取日期
+      cout << "使用命令行参数日期: " << startSunday << endl;
+    }
+  else
+    {
+      cout << "请输入学期第一周周日的日期 (格式 YYYY-MM-DD): ";
+      if (!(cin >> startSunday))
+        startSunday = "2026-03-01"; // 默认备份日期
+    }
+
+  OutputSummary summary;
+  t0 = monotonicNs ();
+  if (!writeOutputs (".", sched, startSunday, cache.inputMtime, opts, summary,
+                     err, stats))
+    {
+      cerr << err << endl;
+      return 1;
+    }
+  runStats.events += summary.events;
+  unsigned long long writeNs = monotonicNs () - t0;
+  cout << "生成完成，保存在 schedule.ics" << endl;
+  if (opts.deltaIcs)
+    cout << "增量日历已生成: schedule-delta.ics（新增 " << summary.delta.added
+         << "，变更 " << summary.delta.changed << "，取消 "
+         << summary.delta.cancelled << "）" << endl;
+  cout << "CSV 课程表已生成: courses.csv" << endl;
   cout << "旧版 HTML 已同步生成至 exp_old.html 和 "
           "eams/courseTableForStd.action 系列文件"
        << endl;
 
+  // 等待输入日期的时间不计入总耗时
+  if (opts.stats && !opts.writeStats (runStats, (loadNs + writeNs) / 1e9, 1))
+    return 1;
   return 0;
 }
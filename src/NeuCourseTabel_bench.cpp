@@ -0,0 +1,912 @@
+/**
+ * @file NeuCourseTabel_bench.cpp
+ * @author PopulusYang
+ * @brief 课表解析与输出的基准测试，附带合成课表页面生成器
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+// 按参数生成一份仿新版教务系统的课表页面（课程数、冲突容器、周数写法、
+// 前后门户噪声大小均可调），再对解析的各个步骤和每种输出分别计时。
+// 结果以 JSON 输出到标准输出，便于在版本之间对比。--emit 只输出生成的
+// 页面，可当作测试用的 exp.html。
+
+#include "NeuCourseCore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// ---- 合成页面生成器 ----
+
+struct GeneratorOptions
+{
+  unsigned seed;
+  int courses;         // 每周的课程块个数（约数）
+  double conflictRate; // 一个块内放多门课（冲突容器）的比例
+  string weekStyle;    // simple / parity / list / mixed
+  int noiseKb;         // 课表前后的门户噪声总大小
+  bool pretty;         // 是否像浏览器另存那样逐行换行
+  int variants; // 每个格子可选的教学班个数，0 表示每个学生的课都随机生成
+};
+
+// 与平台无关的伪随机数，保证同一种子在各平台生成相同的页面
+class Random
+{
+public:
+  explicit Random (unsigned seed) : state_ (seed * 2654435761ULL + 1) {}
+
+  unsigned
+  next ()
+  {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned)(state_ >> 33);
+  }
+
+  int
+  below (int n)
+  {
+    return (int)(next () % (unsigned)n);
+  }
+
+  double
+  unit ()
+  {
+    return next () / 2147483648.0;
+  }
+
+  template <size_t N>
+  const char *
+  pick (const char *const (&items)[N])
+  {
+    return items[below ((int)N)];
+  }
+
+private:
+  unsigned long long state_;
+};
+
+const char *const TITLES[] = {
+  "高等数学A(一)", "大学物理",   "线性代数", "程序设计基础",
+  "数据结构",      "英语(二)",   "体育",     "形势与政策",
+  "离散数学",      "概率论",     "计算机网络", "操作系统",
+};
+const char *const ROOMS[] = {
+  "浑南校区 信息学馆B101", "南湖校区 综合楼301", "浑南校区 文管A203",
+  "实验室",                "浑南校区 一号楼 204",
+};
+const char *const TEACHERS[] = { "张三", "李四", "王五 赵六", "钱七" };
+const char *const SIMPLE_WEEKS[] = { "1-16周", "1-12周", "9周", "3-18周" };
+const char *const PARITY_WEEKS[] = { "11-13周(单)", "2-16周(双)",
+                                     "4-15周(单)", "1-17周(单)" };
+const char *const LIST_WEEKS[] = { "1,3,5-8周", "1-8周,10-16周",
+                                   "2,4,6,8周", "1-4周,6-9周,12周" };
+
+const char *
+pickWeeks (Random &rng, const string &style)
+{
+  if (style == "simple")
+    return rng.pick (SIMPLE_WEEKS);
+  if (style == "parity")
+    return rng.pick (PARITY_WEEKS);
+  if (style == "list")
+    return rng.pick (LIST_WEEKS);
+  switch (rng.below (3))
+    {
+    case 0:
+      return rng.pick (SIMPLE_WEEKS);
+    case 1:
+      return rng.pick (PARITY_WEEKS);
+    default:
+      return rng.pick (LIST_WEEKS);
+    }
+}
+
+void
+appendNoise (string &out, size_t bytes, const char *nl)
+{
+  string unit = "<div class=\"el-card\"><div class=\"title\">我的应用</div>"
+                "<div class=\"title\">公告消息情况</div>"
+                "<div class=\"content\"><span>通知 内容 lorem ipsum</span>"
+                "<a href=\"#\">链接</a>"
+                "</div></div>";
+  unit += nl;
+  for (size_t n = 0; n < bytes; n += unit.size ())
+    out += unit;
+}
+
+// 生成一份课表页面。每天 12 节按随机的 flex 切成若干格子，约 courses/7
+// 个格子放课程，其余为空格子。variants 不为 0 时格子中的课从该格子固定
+// 的 variants 个教学班中选一个，不同种子的学生会选到相同的教学班
+string
+generatePage (const GeneratorOptions &opt)
+{
+  Random rng (opt.seed);
+  const char *nl = opt.pretty ? "\n" : "";
+  string out = "<html><head><title>课表</title></head><body>";
+  out += nl;
+  appendNoise (out, (size_t)opt.noiseKb * 1024 / 2, nl);
+  out += "<select><option value=\"1\">2024-2025学年 秋季</option>"
+         "<option selected=\"\">2025-2026学年 春季(当前)</option></select>";
+  out += nl;
+  out += "<div class=\"kbappTimetableRoot\" style=\"display: flex;\">";
+  out += nl;
+
+  double fill = min (1.0, opt.courses / (7.0 * 5.0)); // 每天约 5 个格子
+  char buf[256];
+  for (int day = 0; day < 7; ++day)
+    {
+      out += "<div class=\"kbappTimetableDayColumnRoot\" "
+             "style=\"flex: 1 1 0%;\">";
+      out += nl;
+      for (int period = 1; period <= 12;)
+        {
+          int flex = rng.unit () < 0.5 ? 1 + rng.below (4) : 2;
+          flex = min (flex, 13 - period);
+          if (rng.unit () < fill)
+            {
+              // 格子的位置和所选的教学班决定其中的课
+              unsigned cell = ((day * 13 + period) * 5 + flex) * 1009;
+              Random section (opt.variants
+                                  ? cell + rng.below (opt.variants)
+                                  : 0);
+              Random &src = opt.variants ? section : rng;
+              int n = src.unit () < opt.conflictRate ? 2 + src.below (2) : 1;
+              snprintf (buf, sizeof buf, "<div style=\"flex: %d 1 0%%;\">%s"
+                        "<div class=\"kbappTimetableCourseRenderRoot\" "
+                        "style=\"flex: 1;\">%s",
+                        flex, nl, nl);
+              out += buf;
+              for (int k = 0; k < n; ++k)
+                {
+                  snprintf (buf, sizeof buf,
+                            "<div class=\"title\">  %s%s </div>%s",
+                            src.pick (TITLES), nl, nl);
+                  out += buf;
+                  const char *weeks = pickWeeks (src, opt.weekStyle);
+                  const char *room = src.pick (ROOMS);
+                  const char *teacher = src.pick (TEACHERS);
+                  snprintf (buf, sizeof buf,
+                            "<div class=\"kbappTimetableCourseRenderCourse"
+                            "ItemInfoText\">%s %s %s</div>%s",
+                            weeks, room, teacher, nl);
+                  out += buf;
+                  if (src.unit () < 0.5)
+                    {
+                      snprintf (buf, sizeof buf,
+                                "<div class=\"kbappTimetableCourseRender"
+                                "CourseItemInfoText\"> %s </div>%s",
+                                src.pick (TEACHERS), nl);
+                      out += buf;
+                    }
+                }
+              out += "</div></div>";
+              out += nl;
+            }
+          else
+            {
+              snprintf (buf, sizeof buf,
+                        "<div class=\"kbappTimetableDayColumnEmpty\" "
+                        "style=\"flex: %d 1 0%%;\"></div>%s",
+                        flex, nl);
+              out += buf;
+            }
+          period += flex;
+        }
+      out += "</div>";
+      out += nl;
+    }
+  out += "</div>";
+  out += nl;
+  appendNoise (out, (size_t)opt.noiseKb * 1024 / 2, nl);
+  out += "<div style=\"flex: 1\"><div class=\"title\">学习日程</div>"
+         "<div class=\"title\">2026-03-02 08:30</div></div></body></html>";
+  return out;
+}
+
+// ---- 堆分配计数 ----
+// 替换全局的 operator new，统计各项基准每次调用的堆分配次数
+
+atomic<unsigned long long> allocations (0);
+
+void *
+operator new (size_t n)
+{
+  ++allocations;
+  void *p = malloc (n ? n : 1);
+  if (!p)
+    throw bad_alloc ();
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  free (p);
+}
+
+// 热路径上单次调用允许的堆分配次数：每页固定的部分，加上每门课（展开式
+// ICS 另按每门课的平均周数）的部分。--check-allocs 时超出即视为回退。
+// 解析时课程文字都放进按页的字符串池，次数与课程数无关（实测 34-47
+// 次）；输出时 ICS 的 UID 与正文、HTML 单元格的两段文字各需一次，其余
+// 应当都落在复用的缓冲区里，每页固定的部分只留给输出流的扩容和表头
+struct AllocBudget
+{
+  const char *name;
+  double perPage;
+  double perCourse;
+  double perWeek;
+};
+
+const AllocBudget ALLOC_BUDGETS[]
+    = { { "extract_courses", 64, 0, 0 },   { "parse_schedule", 64, 0, 0 },
+        { "parse_weeks", 0, 0, 0 },        { "emit_ics", 32, 6, 0 },
+        { "emit_ics_expanded", 32, 1, 5 }, { "emit_csv", 32, 1, 0 },
+        { "emit_html", 32, 8, 0 } };
+
+// ---- 旧的日期展开 ----
+// SemesterCalendar 之前逐个事件使用的做法：重新解析起始日期，经
+// mktime/localtime 加天数，再拼成字符串。只作为 expand_dates 的对照
+
+string
+addDaysMktime (const string &startDate, int days)
+{
+  struct tm tm = {};
+  int y, m, d;
+  char sep;
+  stringstream ss (startDate);
+  if (!(ss >> y >> sep >> m >> sep >> d))
+    return "19700101";
+  tm.tm_year = y - 1900;
+  tm.tm_mon = m - 1;
+  tm.tm_mday = d;
+  tm.tm_isdst = -1;
+
+  static mutex tzLock;
+  struct tm newTm;
+  {
+    lock_guard<mutex> guard (tzLock);
+    time_t t = mktime (&tm);
+    t += (long long)days * 24 * 60 * 60;
+#ifdef _WIN32
+    localtime_s (&newTm, &t);
+#else
+    localtime_r (&t, &newTm);
+#endif
+  }
+
+  ostringstream oss;
+  oss << setfill ('0') << setw (4) << (newTm.tm_year + 1900) << setw (2)
+      << (newTm.tm_mon + 1) << setw (2) << newTm.tm_mday;
+  return oss.str ();
+}
+
+// 旧版 getTime 每次返回一个 string
+string
+getTimeString (int period, bool isStart)
+{
+  return getTime (period, isStart);
+}
+
+// ---- 计时 ----
+
+// 防止被测结果被优化掉
+volatile size_t sink;
+
+struct Result
+{
+  string name;
+  unsigned long long iterations;
+  double nsPerOp;  // 各轮中位数
+  double nsMin;    // 各轮最小值
+  size_t bytes;    // 每次处理的字节数，用于计算吞吐，0 表示不适用
+  size_t items;    // 每次处理的条目数（课程、字符串等），0 表示不适用
+  unsigned long long allocs; // 单次调用的堆分配次数
+};
+
+// 先估算单次耗时，再跑 reps 轮、每轮约 minTime / reps 秒
+template <typename F>
+Result
+measure (const string &name, double minTime, int reps, size_t bytes,
+         size_t items, F body)
+{
+  Clock::time_point t0 = Clock::now ();
+  body ();
+  double once = chrono::duration<double> (Clock::now () - t0).count ();
+  unsigned long long allocsBefore = allocations;
+  body ();
+  unsigned long long allocs = allocations - allocsBefore;
+  unsigned long long perRep = (unsigned long long)(minTime / reps
+                                                   / max (once, 1e-9));
+  if (perRep < 1)
+    perRep = 1;
+
+  vector<double> samples;
+  for (int r = 0; r < reps; ++r)
+    {
+      t0 = Clock::now ();
+      for (unsigned long long i = 0; i < perRep; ++i)
+        body ();
+      double ns = chrono::duration<double, nano> (Clock::now () - t0).count ();
+      samples.push_back (ns / perRep);
+    }
+  sort (samples.begin (), samples.end ());
+  Result res;
+  res.name = name;
+  res.iterations = perRep * reps;
+  res.nsPerOp = samples[samples.size () / 2];
+  res.nsMin = samples.front ();
+  res.bytes = bytes;
+  res.items = items;
+  res.allocs = allocs;
+  return res;
+}
+
+// ---- 常驻进程与逐任务启动进程的对照 ----
+// 同一页面分别交给每次新启动的 NeuCourseTabel --pipe ics 和常驻的
+// NeuCourseTabel --serve 转换，测量每个任务从发出到收齐输出的时间
+
+#ifndef _WIN32
+
+bool
+writeAll (int fd, const char *p, size_t n)
+{
+  while (n > 0)
+    {
+      ssize_t w = write (fd, p, n);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w <= 0)
+        return false;
+      p += w;
+      n -= w;
+    }
+  return true;
+}
+
+// 启动 bin --pipe ics，写入页面并读完输出，返回输出的字节数
+size_t
+execJob (const string &bin, const string &page)
+{
+  int in[2], out[2];
+  if (pipe (in) < 0 || pipe (out) < 0)
+    return 0;
+  pid_t pid = fork ();
+  if (pid == 0)
+    {
+      dup2 (in[0], 0);
+      dup2 (out[1], 1);
+      close (in[0]);
+      close (in[1]);
+      close (out[0]);
+      close (out[1]);
+      execl (bin.c_str (), bin.c_str (), "--pipe", "ics", "2026-03-01",
+             (char *)NULL);
+      _exit (127);
+    }
+  close (in[0]);
+  close (out[1]);
+  // 管道模式读完输入才开始输出，先写完再读不会互相等待
+  writeAll (in[1], page.data (), page.size ());
+  close (in[1]);
+  char buf[64 * 1024];
+  size_t total = 0;
+  ssize_t n;
+  while ((n = read (out[0], buf, sizeof buf)) > 0)
+    total += n;
+  close (out[0]);
+  waitpid (pid, NULL, 0);
+  return total;
+}
+
+// 连到常驻进程的一条连接
+class WorkerClient
+{
+public:
+  WorkerClient () : pid_ (-1), fd_ (-1), in_ (NULL) {}
+  ~WorkerClient ()
+  {
+    if (in_)
+      fclose (in_);
+    if (pid_ > 0)
+      {
+        kill (pid_, SIGTERM);
+        waitpid (pid_, NULL, 0);
+      }
+  }
+
+  // 启动 bin --serve，等它开始监听后连接
+  bool
+  start (const string &bin)
+  {
+    path_ = "/tmp/NeuCourseTabel_bench." + to_string (getpid ()) + ".sock";
+    pid_ = fork ();
+    if (pid_ == 0)
+      {
+        execl (bin.c_str (), bin.c_str (), "--serve", path_.c_str (),
+               (char *)NULL);
+        _exit (127);
+      }
+    sockaddr_un addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    memcpy (addr.sun_path, path_.c_str (), path_.size ());
+    for (int i = 0; i < 500; ++i)
+      {
+        fd_ = socket (AF_UNIX, SOCK_STREAM, 0);
+        if (connect (fd_, (sockaddr *)&addr, sizeof addr) == 0)
+          {
+            in_ = fdopen (fd_, "r");
+            return true;
+          }
+        close (fd_);
+        usleep (10000);
+      }
+    return false;
+  }
+
+  // 发出 count 个任务并收齐响应，返回输出的总字节数。另开线程发送，
+  // 否则发送被反压阻塞时没有人读取响应
+  size_t
+  run (const string &page, int count)
+  {
+    string request = "JOB 0 2026-03-01 ics " + to_string (page.size ())
+                     + "\n" + page;
+    thread sender ([&] () {
+      for (int i = 0; i < count; ++i)
+        writeAll (fd_, request.data (), request.size ());
+    });
+    size_t total = 0;
+    char line[256];
+    vector<char> body;
+    for (int i = 0; i < count; ++i)
+      {
+        int parts = 0;
+        if (!fgets (line, sizeof line, in_)
+            || sscanf (line, "OK %*s %*s %d", &parts) != 1)
+          break;
+        for (int k = 0; k < parts; ++k)
+          {
+            size_t len = 0;
+            if (!fgets (line, sizeof line, in_)
+                || sscanf (line, "%*s %zu", &len) != 1)
+              break;
+            body.resize (len + 1);
+            total += fread (&body[0], 1, len, in_);
+          }
+      }
+    sender.join ();
+    return total;
+  }
+
+private:
+  pid_t pid_;
+  int fd_;
+  FILE *in_;
+  string path_;
+};
+
+#endif
+
+string
+jsonString (const string &s)
+{
+  string out = "\"";
+  for (size_t i = 0; i < s.size (); ++i)
+    {
+      char c = s[i];
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+  return out + "\"";
+}
+
+void
+printUsage ()
+{
+  cerr << "用法: NeuCourseTabel_bench [选项]\n"
+          "  --courses N        每周课程块个数，默认 30\n"
+          "  --conflicts R      冲突容器比例 0-1，默认 0.2\n"
+          "  --weeks STYLE      周数写法 simple/parity/list/mixed，默认 "
+          "mixed\n"
+          "  --noise-kb N       门户噪声大小，默认 3000\n"
+          "  --pretty           逐行换行的页面\n"
+          "  --seed N           随机种子，默认 1\n"
+          "  --variants N       每个格子从固定的 N 个教学班中选课，模拟同"
+          "年级学生共用教学班；默认 0 为完全随机\n"
+          "  --input FILE       改用现成的页面，忽略以上生成参数\n"
+          "  --min-time S       每项基准的总计时长，默认 0.5\n"
+          "  --filter TEXT      只运行名称包含 TEXT 的基准\n"
+          "  --emit FILE        只把生成的页面写入 FILE（- 为标准输出）\n"
+          "  --worker BIN       另外对比逐任务启动 BIN 与常驻的 BIN --serve "
+          "的单任务延迟\n"
+          "  --check-allocs     解析每页、输出每门课的堆分配次数超出预算时"
+          "返回 2\n"
+          "  --scanner NAME     解析时改用 avx2/sse2/scalar 实现的标记扫描"
+       << endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GeneratorOptions gen;
+  gen.seed = 1;
+  gen.courses = 30;
+  gen.conflictRate = 0.2;
+  gen.weekStyle = "mixed";
+  gen.noiseKb = 3000;
+  gen.pretty = false;
+  gen.variants = 0;
+  string input, emit, filter, workerBin;
+  double minTime = 0.5;
+  bool checkAllocs = false;
+  string scanner;
+  for (int i = 1; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--courses" && i + 1 < argc)
+        gen.courses = atoi (argv[++i]);
+      else if (arg == "--conflicts" && i + 1 < argc)
+        gen.conflictRate = atof (argv[++i]);
+      else if (arg == "--weeks" && i + 1 < argc)
+        gen.weekStyle = argv[++i];
+      else if (arg == "--noise-kb" && i + 1 < argc)
+        gen.noiseKb = atoi (argv[++i]);
+      else if (arg == "--pretty")
+        gen.pretty = true;
+      else if (arg == "--seed" && i + 1 < argc)
+        gen.seed = (unsigned)atol (argv[++i]);
+      else if (arg == "--variants" && i + 1 < argc)
+        gen.variants = atoi (argv[++i]);
+      else if (arg == "--input" && i + 1 < argc)
+        input = argv[++i];
+      else if (arg == "--min-time" && i + 1 < argc)
+        minTime = atof (argv[++i]);
+      else if (arg == "--filter" && i + 1 < argc)
+        filter = argv[++i];
+      else if (arg == "--emit" && i + 1 < argc)
+        emit = argv[++i];
+      else if (arg == "--worker" && i + 1 < argc)
+        workerBin = argv[++i];
+      else if (arg == "--check-allocs")
+        checkAllocs = true;
+      else if (arg == "--scanner" && i + 1 < argc)
+        scanner = argv[++i];
+      else
+        {
+          printUsage ();
+          return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+  if (gen.weekStyle != "simple" && gen.weekStyle != "parity"
+      && gen.weekStyle != "list" && gen.weekStyle != "mixed")
+    {
+      printUsage ();
+      return 1;
+    }
+  if (!scanner.empty () && !setMarkerScanner (scanner))
+    {
+      cerr << "不支持的标记扫描实现 " << scanner << endl;
+      return 1;
+    }
+
+  string page;
+  if (!input.empty ())
+    {
+      ifstream in (input.c_str (), ios::binary);
+      if (!in)
+        {
+          cerr << "无法读取 " << input << endl;
+          return 1;
+        }
+      page.assign ((istreambuf_iterator<char> (in)),
+                   istreambuf_iterator<char> ());
+    }
+  else
+    page = generatePage (gen);
+
+  if (!emit.empty ())
+    {
+      if (emit == "-")
+        cout << page;
+      else
+        {
+          ofstream out (emit.c_str (), ios::binary);
+          out << page;
+          if (!out)
+            {
+              cerr << "无法写入 " << emit << endl;
+              return 1;
+            }
+        }
+      return 0;
+    }
+
+  // 预先算好各步骤的输入，使每项基准只测一个步骤
+  const char *data = page.data ();
+  size_t size = page.size ();
+  Schedule sched = parseSchedule (data, size);
+  DayRanges days = splitDayColumns (data, size);
+  vector<string> weekTexts; // 近似还原每门课的第一行详情
+  size_t weekCountTotal = 0;
+  for (size_t i = 0; i < sched.courses.size (); ++i)
+    {
+      const Course &c = sched.courses[i];
+      weekTexts.push_back (c.weekStr.str () + " " + c.location.str () + " "
+                           + c.description.str ());
+      weekCountTotal += weekCount (sched.courses[i].weeks);
+    }
+  const string startSunday = "2026-03-01";
+  const int reps = 5;
+  vector<Result> results;
+
+#define BENCH(name, bytes, items, body)                                       \
+  if (filter.empty () || string (name).find (filter) != string::npos)        \
+    results.push_back (measure (name, minTime, reps, bytes, items, body));
+
+  // 整页的标记扫描，各实现分别计时；最后恢复为解析时使用的实现
+  const string activeScanner = markerScanner ();
+  const char *scanners[] = { "avx2", "sse2", "scalar" };
+  for (size_t i = 0; i < sizeof scanners / sizeof scanners[0]; ++i)
+    {
+      if (!setMarkerScanner (scanners[i]))
+        continue;
+      MarkerIndex marks;
+      BENCH (string ("scan_markers_") + scanners[i], size, 0, [&] () {
+        scanMarkers (data, 0, size, marks);
+        sink = marks.at[MARK_DIV_OPEN].size ();
+      });
+    }
+  setMarkerScanner (activeScanner);
+
+  BENCH ("split_columns", size, 0, [&] () {
+    sink = splitDayColumns (data, size).size ();
+  });
+  BENCH ("extract_courses", size, sched.courses.size (), [&] () {
+    vector<Course> courses;
+    StringPool strings;
+    extractCourses (data, days, courses, strings);
+    sink = courses.size ();
+  });
+  BENCH ("parse_schedule", size, sched.courses.size (), [&] () {
+    sink = parseSchedule (data, size).courses.size ();
+  });
+  BENCH ("parse_weeks", 0, weekTexts.size (), [&] () {
+    WeekMask m = 0;
+    for (size_t i = 0; i < weekTexts.size (); ++i)
+      m ^= parseWeeks (weekTexts[i]);
+    sink = (size_t)m;
+  });
+  BENCH ("expand_dates", 0, weekCountTotal, [&] () {
+    SemesterCalendar cal (startSunday);
+    char buf[16];
+    size_t n = 0;
+    for (size_t i = 0; i < sched.courses.size (); ++i)
+      {
+        const Course &c = sched.courses[i];
+        for (WeekMask m = c.weeks; m; m &= m - 1)
+          n += cal.date (lowestWeek (m), c.day, buf)[7]
+               + getTime (c.startPeriod, true)[1];
+      }
+    sink = n;
+  });
+  BENCH ("expand_dates_mktime", 0, weekCountTotal, [&] () {
+    size_t n = 0;
+    for (size_t i = 0; i < sched.courses.size (); ++i)
+      {
+        const Course &c = sched.courses[i];
+        for (WeekMask m = c.weeks; m; m &= m - 1)
+          {
+            string date = addDaysMktime (startSunday,
+                                         c.day + (lowestWeek (m) - 1) * 7);
+            string startTime = getTimeString (c.startPeriod, true);
+            string endTime = getTimeString (c.endPeriod, false);
+            n += date[7] + startTime[1] + endTime[1];
+          }
+      }
+    sink = n;
+  });
+  BENCH ("emit_ics", 0, sched.courses.size (), [&] () {
+    ostringstream out;
+    writeIcs (out, sched.courses, startSunday, false);
+    sink = (size_t)out.tellp ();
+  });
+  BENCH ("emit_ics_expanded", 0, sched.courses.size (), [&] () {
+    ostringstream out;
+    writeIcs (out, sched.courses, startSunday, true);
+    sink = (size_t)out.tellp ();
+  });
+  BENCH ("emit_csv", 0, sched.courses.size (), [&] () {
+    ostringstream out;
+    writeCsv (out, sched.courses);
+    sink = (size_t)out.tellp ();
+  });
+  BENCH ("emit_html", 0, sched.courses.size (), [&] () {
+    sink = renderOldHtml (sched.courses, sched.semesterInfo).size ();
+  });
+
+  // 5000 名学生的空闲时间查询，学生课表由不同种子生成；准备较慢，只在
+  // 需要时进行
+  const char *freeName = "free_time_5k";
+  if (filter.empty () || string (freeName).find (filter) != string::npos)
+    {
+      GeneratorOptions student = gen;
+      student.noiseKb = 0;
+      vector<Occupancy> occupancy (5000);
+      for (size_t i = 0; i < occupancy.size (); ++i)
+        {
+          student.seed = (unsigned)i + 1;
+          string p = generatePage (student);
+          buildOccupancy (parseSchedule (p.data (), p.size ()).courses,
+                          occupancy[i]);
+        }
+      FreeTimeIndex index;
+      index.build (occupancy);
+      BENCH (freeName, 0, occupancy.size (), [&] () {
+        int counts[SLOT_COUNT];
+        index.countFree (1, 16, NULL, counts);
+        sink = counts[0];
+      });
+    }
+
+  // 1000 名共用教学班的学生（每个格子 8 个教学班可选）的全部输出：逐门课
+  // 生成与由教学班表中的片段拼装对比，每轮都从空表开始
+  const char *cohortName = "emit_cohort_1k";
+  if (filter.empty () || string (cohortName).find (filter) != string::npos)
+    {
+      GeneratorOptions student = gen;
+      student.noiseKb = 0;
+      student.variants = gen.variants ? gen.variants : 8;
+      vector<Schedule> cohort (1000);
+      size_t cohortCourses = 0;
+      for (size_t i = 0; i < cohort.size (); ++i)
+        {
+          student.seed = (unsigned)i + 1;
+          string p = generatePage (student);
+          cohort[i] = parseSchedule (p.data (), p.size ());
+          cohortCourses += cohort[i].courses.size ();
+        }
+      BENCH (cohortName, 0, cohortCourses, [&] () {
+        size_t n = 0;
+        for (size_t i = 0; i < cohort.size (); ++i)
+          {
+            vector<IcsEvent> events;
+            buildIcsEvents (cohort[i].courses, startSunday, false, events);
+            ostringstream csv;
+            writeCsv (csv, cohort[i].courses);
+            n += events.size () + (size_t)csv.tellp ()
+                 + renderOldHtml (cohort[i].courses, cohort[i].semesterInfo)
+                       .size ();
+          }
+        sink = n;
+      });
+      BENCH ("emit_cohort_1k_sections", 0, cohortCourses, [&] () {
+        SectionTable table (startSunday, false);
+        size_t n = 0;
+        for (size_t i = 0; i < cohort.size (); ++i)
+          {
+            vector<const Section *> secs;
+            for (size_t j = 0; j < cohort[i].courses.size (); ++j)
+              secs.push_back (table.intern (cohort[i].courses[j]));
+            vector<IcsEvent> events;
+            buildIcsEvents (secs, events);
+            ostringstream csv;
+            writeCsv (csv, secs);
+            n += events.size () + (size_t)csv.tellp ()
+                 + renderOldHtml (secs, cohort[i].semesterInfo).size ();
+          }
+        sink = n + table.size ();
+      });
+    }
+
+  if (!workerBin.empty ())
+    {
+#ifndef _WIN32
+      const int pipelined = 32;
+      BENCH ("job_exec", size, 0, [&] () {
+        sink = execJob (workerBin, page);
+      });
+      WorkerClient worker;
+      if (!worker.start (workerBin))
+        {
+          cerr << "无法启动 " << workerBin << " --serve" << endl;
+          return 1;
+        }
+      BENCH ("job_worker", size, 0, [&] () { sink = worker.run (page, 1); });
+      BENCH ("job_worker_pipelined", size * pipelined, pipelined, [&] () {
+        sink = worker.run (page, pipelined);
+      });
+#else
+      cerr << "Windows 上不支持 --worker" << endl;
+#endif
+    }
+#undef BENCH
+
+  // JSON 输出
+  cout << "{\n  \"input\": {";
+  if (!input.empty ())
+    cout << "\"file\": " << jsonString (input);
+  else
+    cout << "\"seed\": " << gen.seed << ", \"courses\": " << gen.courses
+         << ", \"conflicts\": " << gen.conflictRate
+         << ", \"weeks\": " << jsonString (gen.weekStyle)
+         << ", \"noise_kb\": " << gen.noiseKb
+         << ", \"pretty\": " << (gen.pretty ? "true" : "false");
+  cout << ", \"scanner\": " << jsonString (markerScanner ());
+  cout << ", \"bytes\": " << size << ", \"parsed_courses\": "
+       << sched.courses.size () << ", \"course_weeks\": " << weekCountTotal
+       << "},\n  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size (); ++i)
+    {
+      const Result &r = results[i];
+      char line[512];
+      int n = snprintf (line, sizeof line,
+                        "%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+                        "\"ns_per_op\": %.1f, \"ns_min\": %.1f",
+                        i ? "," : "", r.name.c_str (), r.iterations,
+                        r.nsPerOp, r.nsMin);
+      if (r.bytes)
+        n += snprintf (line + n, sizeof line - n,
+                       ", \"mb_per_s\": %.1f, \"gb_per_s\": %.2f",
+                       r.bytes / r.nsPerOp * 1e9 / (1024.0 * 1024.0),
+                       r.bytes / r.nsPerOp);
+      n += snprintf (line + n, sizeof line - n, ", \"allocs_per_op\": %llu",
+                     r.allocs);
+      if (r.items)
+        n += snprintf (line + n, sizeof line - n,
+                       ", \"ns_per_item\": %.2f, \"allocs_per_item\": %.2f",
+                       r.nsPerOp / r.items, (double)r.allocs / r.items);
+      snprintf (line + n, sizeof line - n, "}");
+      cout << line;
+    }
+  cout << "\n  ]\n}" << endl;
+
+  int status = 0;
+  for (size_t i = 0; checkAllocs && i < results.size (); ++i)
+    for (size_t j = 0; j < sizeof ALLOC_BUDGETS / sizeof ALLOC_BUDGETS[0];
+         ++j)
+      {
+        const Result &r = results[i];
+        const AllocBudget &b = ALLOC_BUDGETS[j];
+        if (r.name != b.name || !r.items)
+          continue;
+        double budget = b.perPage + b.perCourse * r.items;
+        if (!sched.courses.empty ())
+          budget += b.perWeek * weekCountTotal * r.items
+                    / sched.courses.size ();
+        if (r.allocs > budget)
+          {
+            cerr << r.name << ": 每次 " << r.allocs << " 次堆分配（"
+                 << r.items << " 门课），超出预算 " << budget << endl;
+            status = 2;
+          }
+      }
+  return status;
+}
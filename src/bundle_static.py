@@ -0,0 +1,219 @@
+# -*- coding: utf-8 -*-
+# Author: PopulusYang
+# License: MIT
+# Project: NEU Course Table 静态资源打包
+
+# 生成的课表页面只引用了 resources/static 里的少数几个文件，其余上百 KB 的
+# 脚本和样式从不会被请求。本脚本在构建时：
+#   1. 从页面模板中找出所有 /eams/static/ 引用，按原路径放进输出目录；
+#      原路径下不存在的文件按文件名在 resources/static 中查找替代，
+#      仍找不到的样式表写成空文件；
+#   2. 只保留样式表中选择器能在页面里用到的规则，并压缩空白；
+#   3. 为文本资源生成 .gz 预压缩版本，web_server 在客户端接受 gzip 时直接
+#      发送，不必每次现场压缩。
+# 用法: python bundle_static.py 静态资源目录 输出目录 页面模板...
+
+import gzip
+import os
+import re
+import shutil
+import sys
+
+STATIC_PREFIX = "/eams/static/"
+TEXT_SUFFIXES = (".css", ".js", ".html", ".htm", ".svg", ".json", ".txt")
+KEEP_AT_RULES = ("@font-face", "@keyframes", "@-webkit-keyframes",
+                 "@-moz-keyframes", "@charset", "@import", "@page")
+
+
+def find_references(template_text):
+    """模板中引用的静态资源，返回相对 /eams/static/ 的路径"""
+    refs = re.findall(re.escape(STATIC_PREFIX) + r"([^\"'\s)?#]+)",
+                      template_text)
+    return sorted(set(refs))
+
+
+def resolve(static_dir, rel):
+    """资源在 static_dir 中的实际位置，原路径不存在时按文件名唯一匹配"""
+    path = os.path.join(static_dir, rel)
+    if os.path.isfile(path):
+        return path
+    name = os.path.basename(rel)
+    matches = []
+    for d, _, files in os.walk(static_dir):
+        if name in files:
+            matches.append(os.path.join(d, name))
+    return matches[0] if len(matches) == 1 else None
+
+
+# ---- 样式表处理 ----
+
+def strip_comments(css):
+    return re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+
+
+def split_blocks(css):
+    """把样式表切成 (前导部分, 花括号内部) 列表，跳过引号中的花括号"""
+    blocks = []
+    i, n = 0, len(css)
+    while i < n:
+        open_at = i
+        quote = None
+        while open_at < n:
+            c = css[open_at]
+            if quote:
+                if c == quote:
+                    quote = None
+            elif c in "\"'":
+                quote = c
+            elif c == "{":
+                break
+            elif c == ";" and css[i:open_at].lstrip().startswith("@"):
+                break  # @charset/@import 等没有花括号的规则
+            open_at += 1
+        if open_at >= n:
+            break
+        if css[open_at] == ";":
+            blocks.append((css[i:open_at + 1].strip(), None))
+            i = open_at + 1
+            continue
+        depth = 0
+        j = open_at
+        quote = None
+        while j < n:
+            c = css[j]
+            if quote:
+                if c == quote:
+                    quote = None
+            elif c in "\"'":
+                quote = c
+            elif c == "{":
+                depth += 1
+            elif c == "}":
+                depth -= 1
+                if depth == 0:
+                    break
+            j += 1
+        blocks.append((css[i:open_at].strip(), css[open_at + 1:j]))
+        i = j + 1
+    return blocks
+
+
+def selector_used(selector, words):
+    """选择器中的类名和 id 是否都出现在页面里；伪类、伪元素不计"""
+    selector = re.sub(r"::?[-\w]+(\([^)]*\))?", "", selector)
+    selector = re.sub(r"\[[^\]]*\]", "", selector)
+    names = re.findall(r"[.#](-?[_a-zA-Z][-\w]*)", selector)
+    return all(name in words for name in names)
+
+
+def minify_block(text):
+    text = re.sub(r"\s+", " ", text).strip()
+    text = re.sub(r"\s*([;:,{}])\s*", r"\1", text)
+    return text.rstrip(";")
+
+
+def minify_selector(selector):
+    selector = re.sub(r"\s+", " ", selector).strip()
+    return re.sub(r"\s*([,>+~])\s*", r"\1", selector)
+
+
+def prune_css(css, words):
+    """只保留页面可能用到的规则，返回压缩后的样式表"""
+    out = []
+    for prelude, body in split_blocks(strip_comments(css)):
+        if body is None:
+            out.append(minify_selector(prelude))
+        elif prelude.startswith("@"):
+            if prelude.startswith(KEEP_AT_RULES):
+                out.append(minify_selector(prelude) + "{"
+                           + minify_block(body) + "}")
+            else:  # @media 等：递归处理内部规则
+                inner = prune_css(body, words)
+                if inner:
+                    out.append(minify_selector(prelude) + "{" + inner + "}")
+        else:
+            selectors = [s for s in prelude.split(",")
+                         if s.strip() and selector_used(s, words)]
+            if selectors:
+                out.append(",".join(minify_selector(s) for s in selectors)
+                           + "{" + minify_block(body) + "}")
+    return "".join(out)
+
+
+def local_urls(css):
+    """样式表中引用的本地相对路径（图片、字体）"""
+    urls = re.findall(r"url\(\s*['\"]?([^'\")]+)['\"]?\s*\)", css)
+    return [u.split("?")[0].split("#")[0] for u in urls
+            if not re.match(r"^(data:|[a-z]+://|/)", u)]
+
+
+# ---- 输出 ----
+
+def write_file(out_dir, rel, data, stats):
+    path = os.path.join(out_dir, rel)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+    stats["files"] += 1
+    stats["bytes"] += len(data)
+    if rel.endswith(TEXT_SUFFIXES):
+        packed = gzip.compress(data, 9, mtime=0)  # mtime=0 使输出可复现
+        if len(packed) < len(data) * 0.9:
+            with open(path + ".gz", "wb") as f:
+                f.write(packed)
+            stats["gzip"] += len(packed)
+            return
+    stats["gzip"] += len(data)
+
+
+def main():
+    if len(sys.argv) < 4:
+        print("用法: bundle_static.py 静态资源目录 输出目录 页面模板...")
+        return 1
+    static_dir, out_dir = sys.argv[1], sys.argv[2]
+    template = ""
+    for name in sys.argv[3:]:
+        with open(name, encoding="utf-8") as f:
+            template += f.read()
+    words = set(re.findall(r"[-\w]+", template))
+
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)  # 清掉上次构建留下的旧文件
+    stats = {"files": 0, "bytes": 0, "gzip": 0}
+    pending = [(rel, None) for rel in find_references(template)]
+    done = set()
+    while pending:
+        rel, src = pending.pop()
+        if rel in done:
+            continue
+        done.add(rel)
+        src = src or resolve(static_dir, rel)
+        if not src:
+            print("警告: 找不到页面引用的 /eams/static/" + rel)
+            if rel.endswith(".css"):  # 写成空样式表，省掉浏览器的一次 404
+                write_file(out_dir, rel, b"", stats)
+            continue
+        with open(src, "rb") as f:
+            data = f.read()
+        if rel.endswith(".css"):
+            css = prune_css(data.decode("utf-8", "replace"), words)
+            for url in local_urls(css):
+                dep_src = os.path.normpath(
+                    os.path.join(os.path.dirname(src), url))
+                dep_rel = os.path.normpath(
+                    os.path.join(os.path.dirname(rel), url)).replace("\\", "/")
+                if os.path.isfile(dep_src) and not dep_rel.startswith(".."):
+                    pending.append((dep_rel, dep_src))
+            data = css.encode("utf-8")
+        write_file(out_dir, rel, data, stats)
+
+    total = sum(os.path.getsize(os.path.join(d, f))
+                for d, _, files in os.walk(static_dir) for f in files)
+    print("静态资源: %d 个文件，%d KB（原目录 %d KB），gzip 后 %d KB"
+          % (stats["files"], stats["bytes"] // 1024, total // 1024,
+             stats["gzip"] // 1024))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -12,6 +12,8 @@ import threading
 import socket
 from http.server import HTTPServer, SimpleHTTPRequestHandler
 
+import neucourse
+
 class App:
     def __init__(self, root):
         self.root = root # 保存根窗口引用
@@ -43,6 +45,8 @@ class App:
         self.btn_server.pack()
         self.server_thread = None
         self.httpd = None
+        self.server_proc = None # 原生 web_server 进程
+        self.core = None # 进程内调用的解析库 libneucourse，首次生成时加载
 
         self.status_var = tk.StringVar(value="等待操作...") # 状态变量
         self.status_label = tk.Label(root, textvariable=self.status_var, fg="blue", bg=self.bg_color) # 状态显示标签
@@ -59,6 +63,13 @@ class App:
             return "127.0.0.1"
 
     def toggle_server(self):
+        if self.server_proc:
+            self.server_proc.terminate() # 关闭原生服务器
+            self.server_proc.wait()
+            self.server_proc = None
+            self.btn_server.config(text="开启后端共享", bg="#6c757d")
+            self.status_var.set("后端已关闭")
+            return
         if self.httpd:
             self.httpd.shutdown()
             self.httpd = None
@@ -66,6 +77,24 @@ class App:
             self.status_var.set("后端已关闭")
             return
 
+        # 优先使用编译出的原生 web_server（epoll + keep-alive，文件常驻内存）
+        proj_root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        server_bin = self.get_bin_path("web_server")
+        if os.path.exists(server_bin):
+            try:
+                static_dir = os.path.join(os.path.dirname(server_bin), "eams", "static") # 构建时打包的精简资源
+                if not os.path.isdir(static_dir):
+                    static_dir = os.path.join(proj_root, "resources", "static") # 映射到 /eams/static/
+                self.server_proc = subprocess.Popen([server_bin, "--static", static_dir], cwd=proj_root)
+                ip = self.get_local_ip()
+                url = f"http://{ip}:8080/exp_old.html"
+                self.status_var.set(f"已开启！共享地址: {url}  日历订阅: webcal://{ip}:8080/schedule.ics")
+                self.btn_server.config(text="关闭后端共享", bg="#dc3545")
+                return
+            except Exception as e:
+                self.server_proc = None
+                self.status_var.set(f"原生服务启动失败，改用内置服务: {e}") # 退回 Python 服务器
+
         def run_server():
             nonlocal self
             try:
@@ -121,9 +150,30 @@ class App:
         except Exception as e:
             self.status_var.set(f"发生错误: {str(e)}") # 捕获并显示错误
 
+    def load_core(self):
+        if self.core is None:
+            script_dir = os.path.dirname(os.path.abspath(__file__))
+            bin_dirs = [os.path.dirname(self.get_bin_path("NeuCourseTabel")) or ".",
+                        os.path.join(script_dir, "..", "build", "bin")]
+            self.core = neucourse.load(bin_dirs) or False # False 表示没有找到，不再重复查找
+        return self.core
+
     def generate_ics(self):
         date = self.date_entry.get() # 获取输入框日期
         self.status_var.set("正在解析并生成日历...") # 更新状态
+
+        core = self.load_core()
+        if core:
+            # 进程内调用解析库，在后台线程中进行，窗口不会卡住
+            self.btn_gen.config(state=tk.DISABLED)
+            def work():
+                try:
+                    count = core.convert_file("exp.html", ".", date)
+                    self.root.after(0, lambda: self.generate_done(None, count))
+                except Exception as e:
+                    self.root.after(0, lambda: self.generate_done(str(e), 0))
+            threading.Thread(target=work, daemon=True).start()
+            return
         
         bin_path = self.get_bin_path("NeuCourseTabel") # 获取 C++ 解析器路径
         
@@ -141,6 +191,15 @@ class App:
         except Exception as e:
             self.status_var.set(f"发生错误: {str(e)}") # 其他异常
 
+    def generate_done(self, error, count):
+        self.btn_gen.config(state=tk.NORMAL)
+        if error is None:
+            self.status_var.set(f"成功！提取 {count} 门课程，生成了 schedule.ics")
+            messagebox.showinfo("完成", "日历文件生成成功！\n请将生成的 schedule.ics 导入你的日历软件。")
+        else:
+            self.status_var.set("解析失败")
+            messagebox.showerror("错误", f"解析失败:\n{error}")
+
 if __name__ == "__main__":
     root = tk.Tk()
     app = App(root)
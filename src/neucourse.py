@@ -0,0 +1,184 @@
+# -*- coding: utf-8 -*-
+# Author: PopulusYang
+# License: MIT
+# Project: NEU Course Table 解析库的 Python 绑定
+
+# 通过 ctypes 加载构建生成的 libneucourse，在进程内解析课表、生成输出，
+# 不必启动 NeuCourseTabel 子进程，也不必经过磁盘上的临时文件。
+#
+#   lib = neucourse.load([bin_dir])
+#   sched = lib.parse(html_bytes)
+#   ics = sched.ics("2026-03-01")
+#   lib.convert_file("exp.html", ".", "2026-03-01")
+
+import ctypes
+import os
+
+NCT_OK = 0
+NCT_E_INVALID = -1
+NCT_E_BUFFER = -2
+NCT_E_IO = -3
+NCT_E_INTERNAL = -4
+
+NCT_EXPAND_ICS = 1
+NCT_DELTA_ICS = 2
+NCT_NO_CACHE = 4
+
+LIB_NAMES = ("libneucourse.so", "libneucourse.dylib", "libneucourse.dll",
+             "neucourse.dll")
+
+
+class NeuCourseError(Exception):
+    def __init__(self, code, message=""):
+        super().__init__(message or "错误码 %d" % code)
+        self.code = code
+
+
+class _Course(ctypes.Structure):
+    _fields_ = [("title", ctypes.c_char_p),
+                ("location", ctypes.c_char_p),
+                ("description", ctypes.c_char_p),
+                ("weeks", ctypes.c_char_p),
+                ("day", ctypes.c_int),
+                ("start_period", ctypes.c_int),
+                ("end_period", ctypes.c_int),
+                ("week_mask", ctypes.c_uint64)]
+
+
+class Schedule:
+    """nct_parse 的结果，释放时一并释放 C 侧的句柄"""
+
+    def __init__(self, lib, handle):
+        self._lib = lib
+        self._handle = handle
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if self._handle:
+            self._lib.nct_free(self._handle)
+            self._handle = None
+
+    @property
+    def semester_info(self):
+        return self._lib.nct_semester_info(self._handle).decode("utf-8")
+
+    @property
+    def courses(self):
+        out = []
+        c = _Course()
+        for i in range(self._lib.nct_course_count(self._handle)):
+            self._lib.nct_get_course(self._handle, i, ctypes.byref(c))
+            out.append({
+                "title": c.title.decode("utf-8"),
+                "location": c.location.decode("utf-8"),
+                "description": c.description.decode("utf-8"),
+                "weeks": c.weeks.decode("utf-8"),
+                "day": c.day,
+                "start_period": c.start_period,
+                "end_period": c.end_period,
+                "week_mask": c.week_mask,
+            })
+        return out
+
+    def _emit(self, func, *args):
+        # 先问出所需大小，再分配缓冲区取回；第二次调用不会重新生成
+        size = ctypes.c_size_t(0)
+        rc = func(self._handle, *args, None, 0, ctypes.byref(size))
+        if rc == NCT_OK:
+            return b""
+        if rc != NCT_E_BUFFER:
+            raise NeuCourseError(rc)
+        buf = ctypes.create_string_buffer(size.value)
+        rc = func(self._handle, *args, buf, size.value, ctypes.byref(size))
+        if rc != NCT_OK:
+            raise NeuCourseError(rc)
+        return buf.raw[:size.value]
+
+    def ics(self, start_sunday, expand=False):
+        flags = NCT_EXPAND_ICS if expand else 0
+        return self._emit(self._lib.nct_write_ics,
+                          start_sunday.encode("utf-8"), flags)
+
+    def csv(self):
+        return self._emit(self._lib.nct_write_csv)
+
+    def html(self):
+        return self._emit(self._lib.nct_write_html)
+
+
+class Library:
+    def __init__(self, path):
+        lib = ctypes.CDLL(path)
+        sched_p = ctypes.c_void_p
+        size_p = ctypes.POINTER(ctypes.c_size_t)
+        lib.nct_version.restype = ctypes.c_char_p
+        lib.nct_version.argtypes = []
+        lib.nct_parse.restype = sched_p
+        lib.nct_parse.argtypes = [ctypes.c_char_p, ctypes.c_size_t]
+        lib.nct_free.restype = None
+        lib.nct_free.argtypes = [sched_p]
+        lib.nct_course_count.restype = ctypes.c_size_t
+        lib.nct_course_count.argtypes = [sched_p]
+        lib.nct_get_course.restype = ctypes.c_int
+        lib.nct_get_course.argtypes = [sched_p, ctypes.c_size_t,
+                                       ctypes.POINTER(_Course)]
+        lib.nct_semester_info.restype = ctypes.c_char_p
+        lib.nct_semester_info.argtypes = [sched_p]
+        lib.nct_write_ics.restype = ctypes.c_int
+        lib.nct_write_ics.argtypes = [sched_p, ctypes.c_char_p, ctypes.c_uint,
+                                      ctypes.c_char_p, ctypes.c_size_t, size_p]
+        lib.nct_write_csv.restype = ctypes.c_int
+        lib.nct_write_csv.argtypes = [sched_p, ctypes.c_char_p,
+                                      ctypes.c_size_t, size_p]
+        lib.nct_write_html.restype = ctypes.c_int
+        lib.nct_write_html.argtypes = [sched_p, ctypes.c_char_p,
+                                       ctypes.c_size_t, size_p]
+        lib.nct_convert_file.restype = ctypes.c_int
+        lib.nct_convert_file.argtypes = [ctypes.c_char_p, ctypes.c_char_p,
+                                         ctypes.c_char_p, ctypes.c_uint,
+                                         size_p, ctypes.c_char_p,
+                                         ctypes.c_size_t]
+        self._lib = lib
+        self.path = path
+
+    @property
+    def version(self):
+        return self._lib.nct_version().decode("ascii")
+
+    def parse(self, html):
+        """解析课表页面（bytes 或 str），返回 Schedule"""
+        if isinstance(html, str):
+            html = html.encode("utf-8")
+        handle = self._lib.nct_parse(html, len(html))
+        if not handle:
+            raise NeuCourseError(NCT_E_INTERNAL, "解析失败")
+        return Schedule(self._lib, handle)
+
+    def convert_file(self, input_path, out_dir, start_sunday, flags=0):
+        """与 NeuCourseTabel 单文件模式相同，返回提取到的课程数"""
+        courses = ctypes.c_size_t(0)
+        err = ctypes.create_string_buffer(512)
+        rc = self._lib.nct_convert_file(
+            os.fsencode(input_path), os.fsencode(out_dir),
+            start_sunday.encode("utf-8"), flags, ctypes.byref(courses),
+            err, len(err))
+        if rc != NCT_OK:
+            raise NeuCourseError(rc, err.value.decode("utf-8", "replace"))
+        return courses.value
+
+
+def load(search_dirs=()):
+    """在 search_dirs 和脚本所在目录中查找并加载 libneucourse，
+    找不到时返回 None"""
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    for d in list(search_dirs) + [script_dir]:
+        for name in LIB_NAMES:
+            path = os.path.join(d, name)
+            if os.path.exists(path):
+                try:
+                    return Library(path)
+                except OSError:
+                    pass
+    return None
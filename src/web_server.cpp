@@ -0,0 +1,1433 @@
+/**
+ * @file web_server.cpp
+ * @author PopulusYang
+ * @brief 课表共享服务器：单线程 epoll，取代 web_server.py
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+// 与 web_server.py 的行为保持一致：以当前目录为根目录提供文件，.action
+// 文件按 text/html; charset=utf-8 返回，POST 按 GET 处理，所有响应都带
+// Access-Control-Allow-Origin: *。不同之处在于连接支持 keep-alive，文件
+// 内容缓存在内存中（每秒至多 stat 一次以发现重新生成的文件），单个线程
+// 即可同时服务数千个连接。
+//
+// 指定 --store 时还会把许多学生的课表以学号为键载入内存，按
+// ?id= 参数即时渲染旧版 EAMS 页面、ICS 或 CSV，磁盘上不再需要每个学生
+// 一份输出文件。
+//
+// 课表订阅会被日历 App 反复轮询，因此每个响应都带有由内容散列得到的强
+// ETag 和 Last-Modified，条件请求在内容未变时只需 304 应答头。
+// /subscribe 把浏览器重定向到 webcal:// 地址，由系统日历直接订阅。
+// 文件旁有 .gz 预压缩版本（见 bundle_static.py）时，对接受 gzip 的客户端
+// 直接发送压缩版本。
+
+#include "NeuCourseCore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef shared_ptr<const string> Bytes;
+
+const size_t MAX_HEADER_BYTES = 64 * 1024; // 请求头上限
+const size_t MAX_BODY_BYTES = 1024 * 1024; // POST 请求体上限，超出则断开
+const time_t IDLE_TIMEOUT = 30;            // 空闲连接的超时秒数
+
+volatile sig_atomic_t stopRequested = 0;
+
+void
+onSignal (int)
+{
+  stopRequested = 1;
+}
+
+// ---- 文本辅助函数 ----
+
+// 不区分大小写比较 ASCII 字符串
+bool
+equalsIgnoreCase (const char *a, size_t n, const char *b)
+{
+  size_t m = strlen (b);
+  if (n != m)
+    return false;
+  for (size_t i = 0; i < n; ++i)
+    if (tolower ((unsigned char)a[i]) != tolower ((unsigned char)b[i]))
+      return false;
+  return true;
+}
+
+int
+hexValue (char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// URL 的百分号解码
+string
+urlDecode (const string &s)
+{
+  string out;
+  out.reserve (s.size ());
+  for (size_t i = 0; i < s.size (); ++i)
+    {
+      int hi, lo;
+      if (s[i] == '%' && i + 2 < s.size ()
+          && (hi = hexValue (s[i + 1])) >= 0
+          && (lo = hexValue (s[i + 2])) >= 0)
+        {
+          out += (char)(hi * 16 + lo);
+          i += 2;
+        }
+      else
+        out += s[i];
+    }
+  return out;
+}
+
+// 与 Python mimetypes 相同的常见类型，.action 按网页处理
+string
+contentTypeFor (const string &path)
+{
+  static const char *const TYPES[][2] = {
+    { ".action", "text/html; charset=utf-8" },
+    { ".html", "text/html" },
+    { ".htm", "text/html" },
+    { ".css", "text/css" },
+    { ".js", "text/javascript" },
+    { ".json", "application/json" },
+    { ".png", "image/png" },
+    { ".gif", "image/gif" },
+    { ".jpg", "image/jpeg" },
+    { ".jpeg", "image/jpeg" },
+    { ".ico", "image/vnd.microsoft.icon" },
+    { ".svg", "image/svg+xml" },
+    { ".ics", "text/calendar" },
+    { ".csv", "text/csv" },
+    { ".txt", "text/plain" },
+    { ".woff", "font/woff" },
+    { ".woff2", "font/woff2" },
+    { ".ttf", "font/ttf" },
+    { ".eot", "application/vnd.ms-fontobject" },
+  };
+  for (size_t i = 0; i < sizeof TYPES / sizeof TYPES[0]; ++i)
+    if (hasSuffix (path, TYPES[i][0]))
+      return TYPES[i][1];
+  return "application/octet-stream";
+}
+
+// 内容的强 ETag
+string
+entityTag (const string &body)
+{
+  char buf[24];
+  snprintf (buf, sizeof buf, "\"%016llx\"",
+            (unsigned long long)hashBytes (body.data (), body.size ()));
+  return buf;
+}
+
+// HTTP 日期，如 Sun, 06 Nov 1994 08:49:37 GMT
+string
+formatHttpDate (time_t t)
+{
+  char buf[64];
+  struct tm tmv;
+  gmtime_r (&t, &tmv);
+  strftime (buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+  return buf;
+}
+
+// 解析 HTTP 日期，格式不对时返回 -1
+time_t
+parseHttpDate (const string &s)
+{
+  struct tm tmv;
+  memset (&tmv, 0, sizeof tmv);
+  const char *end = strptime (s.c_str (), "%a, %d %b %Y %H:%M:%S GMT", &tmv);
+  if (!end || *end)
+    return -1;
+  return timegm (&tmv);
+}
+
+// If-None-Match 中是否有与 etag 相同的标签。按弱比较，W/ 前缀不计
+bool
+etagMatches (const string &header, const string &etag)
+{
+  size_t pos = 0;
+  while (pos < header.size ())
+    {
+      size_t end = header.find (',', pos);
+      if (end == string::npos)
+        end = header.size ();
+      size_t b = header.find_first_not_of (" \t", pos);
+      size_t e = header.find_last_not_of (" \t", end - 1);
+      if (b != string::npos && b < end && e >= b)
+        {
+          string tag = header.substr (b, e - b + 1);
+          if (tag == "*")
+            return true;
+          if (tag.compare (0, 2, "W/") == 0)
+            tag.erase (0, 2);
+          if (tag == etag)
+            return true;
+        }
+      pos = end + 1;
+    }
+  return false;
+}
+
+// Accept-Encoding 是否接受 gzip（q=0 表示不接受）
+bool
+acceptsGzip (const string &header)
+{
+  size_t pos = 0;
+  while (pos < header.size ())
+    {
+      size_t end = header.find (',', pos);
+      if (end == string::npos)
+        end = header.size ();
+      string item = header.substr (pos, end - pos);
+      size_t semi = item.find (';');
+      string coding = item.substr (0, semi);
+      coding.erase (0, coding.find_first_not_of (" \t"));
+      coding.erase (coding.find_last_not_of (" \t") + 1);
+      if (equalsIgnoreCase (coding.data (), coding.size (), "gzip")
+          || coding == "*")
+        {
+          size_t q = item.find ("q=", semi == string::npos ? 0 : semi);
+          return q == string::npos || atof (item.c_str () + q + 2) > 0;
+        }
+      pos = end + 1;
+    }
+  return false;
+}
+
+// ---- 文件缓存 ----
+
+struct CachedFile
+{
+  Bytes body;
+  string contentType;
+  string etag;
+  time_t mtime;
+  off_t size;
+  ino_t ino;
+  time_t checkedAt; // 上次 stat 的时间
+};
+
+// 按磁盘路径缓存文件内容。同一文件每秒至多 stat 一次，大小、修改时间或
+// inode 变化时重新读入（输出文件以改名方式替换，同一秒内的替换也能
+// 发现）；正在发送的旧内容由 shared_ptr 保持到发送完毕
+class FileCache
+{
+public:
+  // 返回文件内容，文件不存在或不是普通文件时返回 NULL
+  const CachedFile *
+  get (const string &path, time_t now)
+  {
+    map<string, CachedFile>::iterator it = files_.find (path);
+    if (it != files_.end () && it->second.checkedAt == now)
+      return &it->second;
+
+    struct stat st;
+    if (stat (path.c_str (), &st) != 0 || !S_ISREG (st.st_mode))
+      {
+        if (it != files_.end ())
+          files_.erase (it);
+        return NULL;
+      }
+    if (it != files_.end () && it->second.mtime == st.st_mtime
+        && it->second.size == st.st_size && it->second.ino == st.st_ino)
+      {
+        it->second.checkedAt = now;
+        return &it->second;
+      }
+
+    ifstream in (path.c_str (), ios::binary);
+    if (!in)
+      return NULL;
+    shared_ptr<string> body (new string (
+        (istreambuf_iterator<char> (in)), istreambuf_iterator<char> ()));
+    CachedFile &f = files_[path];
+    f.body = body;
+    f.contentType = contentTypeFor (path);
+    f.etag = entityTag (*body);
+    f.mtime = st.st_mtime;
+    f.size = st.st_size;
+    f.ino = st.st_ino;
+    f.checkedAt = now;
+    return &f;
+  }
+
+  // 与 get 相同，但不存在的结果也缓存到下一秒，用于查找 .gz 等附属文件
+  const CachedFile *
+  variant (const string &path, time_t now)
+  {
+    map<string, time_t>::iterator m = missing_.find (path);
+    if (m != missing_.end () && m->second == now)
+      return NULL;
+    const CachedFile *f = get (path, now);
+    if (f)
+      {
+        if (m != missing_.end ())
+          missing_.erase (m);
+      }
+    else
+      missing_[path] = now;
+    return f;
+  }
+
+  // 启动时预先读入一个目录树，首个请求也不必等磁盘
+  void
+  preload (const string &dir, time_t now)
+  {
+    DIR *d = opendir (dir.c_str ());
+    if (!d)
+      return;
+    vector<string> names;
+    while (struct dirent *ent = readdir (d))
+      {
+        string name = ent->d_name;
+        if (name != "." && name != "..")
+          names.push_back (name);
+      }
+    closedir (d);
+    for (size_t i = 0; i < names.size (); ++i)
+      {
+        string path = dir + "/" + names[i];
+        struct stat st;
+        if (stat (path.c_str (), &st) != 0)
+          continue;
+        if (S_ISDIR (st.st_mode))
+          preload (path, now);
+        else if (S_ISREG (st.st_mode))
+          get (path, now);
+      }
+  }
+
+  size_t
+  totalBytes () const
+  {
+    size_t n = 0;
+    for (map<string, CachedFile>::const_iterator it = files_.begin ();
+         it != files_.end (); ++it)
+      n += it->second.body->size ();
+    return n;
+  }
+
+  size_t
+  count () const
+  {
+    return files_.size ();
+  }
+
+private:
+  map<string, CachedFile> files_;
+  map<string, time_t> missing_; // 不存在的附属文件及其检查时间
+};
+
+// ---- 多学生课表库 ----
+
+// 可以按学号渲染的页面种类
+enum PageFormat
+{
+  PAGE_HTML,
+  PAGE_ICS,
+  PAGE_CSV,
+};
+
+// 常驻内存的页面峰值大小（VmHWM），单位 KB
+long
+peakRssKb ()
+{
+  ifstream in ("/proc/self/status");
+  string line;
+  while (getline (in, line))
+    if (line.compare (0, 6, "VmHWM:") == 0)
+      return atol (line.c_str () + 6);
+  return 0;
+}
+
+// 渲染好的页面及其验证器
+struct RenderedPage
+{
+  Bytes body;
+  string etag;
+  time_t mtime; // 课表来源文件的修改时间
+};
+
+// 以学号为键保存解析好的课表。页面在第一次请求时由 Course 数据渲染，
+// 渲染结果放在按总字节数限制的 LRU 中，超出上限时淘汰最久未用的页面
+class ScheduleStore
+{
+public:
+  ScheduleStore (const string &startSunday, size_t pageBytesLimit)
+      : startSunday_ (startSunday), limit_ (pageBytesLimit), bytes_ (0),
+        hits_ (0), misses_ (0)
+  {
+  }
+
+  // 从目录或清单载入课表，规则见 loadScheduleSet；同时建立空闲时间索引
+  bool
+  load (const string &source, unsigned threads, string &err)
+  {
+    vector<BatchJob> jobs;
+    vector<Schedule> parsed;
+    vector<bool> ok;
+    if (!loadScheduleSet (source, threads, jobs, parsed, ok, err))
+      return false;
+
+    vector<Occupancy> occupancy;
+    for (size_t i = 0; i < jobs.size (); ++i)
+      {
+        if (!ok[i])
+          {
+            cerr << "警告: 无法载入 " << jobs[i].input << endl;
+            continue;
+          }
+        if (schedules_.count (jobs[i].name))
+          {
+            cerr << "警告: 学号 " << jobs[i].name << " 重复，忽略 "
+                 << jobs[i].input << endl;
+            continue;
+          }
+        struct stat st;
+        parsed[i].courses.shrink_to_fit ();
+        Stored &s = schedules_[jobs[i].name];
+        swap (s.sched, parsed[i]);
+        s.mtime = stat (jobs[i].input.c_str (), &st) == 0 ? st.st_mtime : 0;
+        s.index = occupancy.size ();
+        occupancy.push_back (Occupancy ());
+        buildOccupancy (s.sched.courses, occupancy.back ());
+      }
+    free_.build (occupancy);
+    return true;
+  }
+
+  size_t
+  size () const
+  {
+    return schedules_.size ();
+  }
+
+  // 某个学生的页面，学号不存在时返回 false。ICS 的 DTSTAMP 取来源文件
+  // 的修改时间，页面被淘汰后重新渲染，内容和 ETag 也不变
+  bool
+  render (const string &id, PageFormat format, RenderedPage &page)
+  {
+    string key = string (1, (char)('0' + format)) + id;
+    unordered_map<string, list<Entry>::iterator>::iterator hit
+        = index_.find (key);
+    if (hit != index_.end ())
+      {
+        ++hits_;
+        lru_.splice (lru_.begin (), lru_, hit->second);
+        page = hit->second->page;
+        return true;
+      }
+    unordered_map<string, Stored>::const_iterator it = schedules_.find (id);
+    if (it == schedules_.end ())
+      return false;
+
+    ++misses_;
+    const Schedule &sched = it->second.sched;
+    if (format == PAGE_HTML)
+      page.body.reset (new string (renderOldHtml (sched.courses,
+                                                  sched.semesterInfo)));
+    else
+      {
+        ostringstream out;
+        if (format == PAGE_ICS)
+          {
+            vector<IcsEvent> events;
+            buildIcsEvents (sched.courses, startSunday_, false, events);
+            writeIcsCalendar (out, events, vector<IcsEvent> (),
+                              inputTimestamp (it->second.mtime));
+          }
+        else
+          writeCsv (out, sched.courses);
+        page.body.reset (new string (out.str ()));
+      }
+    page.etag = entityTag (*page.body);
+    page.mtime = it->second.mtime;
+
+    Entry e = { key, page };
+    lru_.push_front (e);
+    index_[key] = lru_.begin ();
+    bytes_ += page.body->size ();
+    while (bytes_ > limit_ && lru_.size () > 1)
+      {
+        bytes_ -= lru_.back ().page.body->size ();
+        index_.erase (lru_.back ().key);
+        lru_.pop_back ();
+      }
+    return true;
+  }
+
+  // 空闲时间查询：ids 为逗号分隔的学号，为空时统计全部学生；minFree
+  // 小于 1 时取所选学生数，即所有人都空闲。给了 ids 却一个都找不到时
+  // 返回 false
+  bool
+  freeTime (const string &ids, int firstWeek, int lastWeek, int minFree,
+            string &json) const
+  {
+    vector<uint64_t> selection = free_.emptySelection ();
+    vector<string> unknown;
+    size_t selected = 0;
+    for (size_t pos = 0; !ids.empty () && pos <= ids.size ();)
+      {
+        size_t comma = ids.find (',', pos);
+        if (comma == string::npos)
+          comma = ids.size ();
+        string id = ids.substr (pos, comma - pos);
+        pos = comma + 1;
+        unordered_map<string, Stored>::const_iterator it
+            = schedules_.find (id);
+        if (it == schedules_.end ())
+          {
+            if (!id.empty ())
+              unknown.push_back (id);
+            continue;
+          }
+        uint64_t &word = selection[it->second.index / 64];
+        uint64_t bit = 1ULL << (it->second.index % 64);
+        selected += (word & bit) ? 0 : 1;
+        word |= bit;
+      }
+    if (ids.empty ())
+      selected = free_.size ();
+    else if (selected == 0)
+      return false;
+    if (minFree < 1)
+      minFree = (int)selected;
+
+    int counts[SLOT_COUNT];
+    free_.countFree (firstWeek, lastWeek, ids.empty () ? NULL : &selection,
+                     counts);
+    ostringstream out;
+    writeFreeJson (out, counts, minFree, selected, firstWeek, lastWeek,
+                   unknown);
+    json = out.str ();
+    return true;
+  }
+
+  void
+  report () const
+  {
+    cout << "页面缓存：" << lru_.size () << " 个页面，" << bytes_ / 1024
+         << " KB；命中 " << hits_ << " 次，渲染 " << misses_ << " 次"
+         << endl;
+  }
+
+private:
+  struct Stored
+  {
+    Schedule sched;
+    time_t mtime;
+    size_t index; // 在空闲时间索引中的下标
+  };
+
+  struct Entry
+  {
+    string key;
+    RenderedPage page;
+  };
+
+  string startSunday_;
+  unordered_map<string, Stored> schedules_;
+  FreeTimeIndex free_;
+  list<Entry> lru_; // 最近使用的在前
+  unordered_map<string, list<Entry>::iterator> index_;
+  size_t limit_;
+  size_t bytes_;
+  unsigned long long hits_;
+  unsigned long long misses_;
+};
+
+// 查询串中名为 name 的参数
+bool
+queryParam (const string &query, const string &name, string &value)
+{
+  size_t pos = 0;
+  while (pos < query.size ())
+    {
+      if (query[pos] == '?' || query[pos] == '&')
+        ++pos;
+      size_t end = query.find ('&', pos);
+      if (end == string::npos)
+        end = query.size ();
+      if (query.compare (pos, name.size (), name) == 0
+          && pos + name.size () < end && query[pos + name.size ()] == '=')
+        {
+          size_t from = pos + name.size () + 1;
+          value = urlDecode (query.substr (from, end - from));
+          return true;
+        }
+      pos = end;
+    }
+  return false;
+}
+
+// 查询串中的 id 参数
+bool
+queryId (const string &query, string &id)
+{
+  return queryParam (query, "id", id) && !id.empty ();
+}
+
+// ---- HTTP 连接 ----
+
+// 待发送的一段数据，响应头和文件内容分开存放，文件内容不复制
+struct Chunk
+{
+  Bytes data;
+  size_t offset;
+};
+
+struct Connection
+{
+  int fd;
+  string in;           // 尚未处理完的请求数据
+  deque<Chunk> out;    // 待发送的数据
+  bool closeAfterSend; // 发送完毕后关闭连接
+  bool writeArmed;     // 已注册 EPOLLOUT
+  time_t lastActive;
+};
+
+// 一个解析好的请求
+struct Request
+{
+  string method;
+  string target;
+  string host;
+  string ifNoneMatch;
+  string ifModifiedSince;
+  string acceptEncoding;
+  bool keepAlive;
+  size_t bodyBytes;
+  bool bodyTooLarge;
+};
+
+class Server
+{
+public:
+  Server (const string &root, const string &staticDir, ScheduleStore *store)
+      : root_ (root), staticDir_ (staticDir), store_ (store), epfd_ (-1),
+        listenFd_ (-1), spareFd_ (-1), listenPaused_ (false),
+        fdsExhausted_ (false), dateAt_ (0)
+  {
+  }
+
+  bool
+  listenOn (int port)
+  {
+    listenFd_ = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+    if (listenFd_ < 0)
+      return false;
+    int one = 1;
+    setsockopt (listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in addr;
+    memset (&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_ANY);
+    addr.sin_port = htons ((uint16_t)port);
+    if (bind (listenFd_, (sockaddr *)&addr, sizeof addr) != 0
+        || listen (listenFd_, SOMAXCONN) != 0)
+      return false;
+
+    epfd_ = epoll_create1 (EPOLL_CLOEXEC);
+    if (epfd_ < 0)
+      return false;
+    epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd_;
+    spareFd_ = open ("/dev/null", O_RDONLY | O_CLOEXEC);
+    return epoll_ctl (epfd_, EPOLL_CTL_ADD, listenFd_, &ev) == 0;
+  }
+
+  void
+  preload ()
+  {
+    time_t now = time (NULL);
+    cache_.preload (root_ + "/eams", now);
+    cache_.get (root_ + "/exp_old.html", now);
+    if (!staticDir_.empty ())
+      cache_.preload (staticDir_, now);
+    cout << "已缓存 " << cache_.count () << " 个文件，共 "
+         << cache_.totalBytes () / 1024 << " KB" << endl;
+  }
+
+  void
+  run ()
+  {
+    vector<epoll_event> events (1024);
+    time_t lastSweep = time (NULL);
+    while (!stopRequested)
+      {
+        int n = epoll_wait (epfd_, &events[0], (int)events.size (), 1000);
+        if (n < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            perror ("epoll_wait");
+            break;
+          }
+        time_t now = time (NULL);
+        for (int i = 0; i < n; ++i)
+          {
+            int fd = events[i].data.fd;
+            if (fd == listenFd_)
+              {
+                acceptAll (now);
+                continue;
+              }
+            Connection *c = connection (fd);
+            if (!c)
+              continue;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+              {
+                closeConnection (c);
+                continue;
+              }
+            if ((events[i].events & EPOLLIN) && !readRequests (c, now))
+              continue;
+            if ((events[i].events & EPOLLOUT) || !c->out.empty ())
+              flush (c, now);
+          }
+        if (now != lastSweep)
+          {
+            sweepIdle (now);
+            lastSweep = now;
+          }
+      }
+  }
+
+private:
+  Connection *
+  connection (int fd)
+  {
+    return fd >= 0 && (size_t)fd < conns_.size () ? conns_[fd].get () : NULL;
+  }
+
+  void
+  acceptAll (time_t now)
+  {
+    while (true)
+      {
+        int fd = accept4 (listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+          {
+            if (errno == EINTR || errno == ECONNABORTED)
+              continue;
+            if (errno == EMFILE || errno == ENFILE)
+              {
+                if (!fdsExhausted_)
+                  perror ("accept4");
+                fdsExhausted_ = true;
+                if (rejectPending ())
+                  continue;
+                return;
+              }
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+              perror ("accept4");
+            return;
+          }
+        fdsExhausted_ = false;
+        int one = 1;
+        setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        if ((size_t)fd >= conns_.size ())
+          conns_.resize (fd + 1);
+        conns_[fd].reset (new Connection ());
+        Connection *c = conns_[fd].get ();
+        c->fd = fd;
+        c->closeAfterSend = false;
+        c->writeArmed = false;
+        c->lastActive = now;
+        epoll_event ev;
+        memset (&ev, 0, sizeof ev);
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        epoll_ctl (epfd_, EPOLL_CTL_ADD, fd, &ev);
+      }
+  }
+
+  // 文件描述符用尽时监听套接字一直可读，不处理会让 epoll_wait 空转。
+  // 先关掉预留的描述符，接受一个连接后立即关闭，再把预留的描述符占回来；
+  // 连预留的也没有时暂停监听，等有连接关闭再恢复。
+  // 能继续接受时返回 true
+  bool
+  rejectPending ()
+  {
+    if (spareFd_ >= 0)
+      {
+        close (spareFd_);
+        int fd = accept4 (listenFd_, NULL, NULL, SOCK_CLOEXEC);
+        if (fd >= 0)
+          close (fd);
+        spareFd_ = open ("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+          return true;
+      }
+    epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.data.fd = listenFd_;
+    epoll_ctl (epfd_, EPOLL_CTL_MOD, listenFd_, &ev);
+    listenPaused_ = true;
+    return false;
+  }
+
+  void
+  closeConnection (Connection *c)
+  {
+    int fd = c->fd;
+    epoll_ctl (epfd_, EPOLL_CTL_DEL, fd, NULL);
+    close (fd);
+    conns_[fd].reset ();
+    if (spareFd_ < 0)
+      spareFd_ = open ("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (listenPaused_)
+      {
+        epoll_event ev;
+        memset (&ev, 0, sizeof ev);
+        ev.events = EPOLLIN;
+        ev.data.fd = listenFd_;
+        epoll_ctl (epfd_, EPOLL_CTL_MOD, listenFd_, &ev);
+        listenPaused_ = false;
+      }
+  }
+
+  void
+  sweepIdle (time_t now)
+  {
+    for (size_t fd = 0; fd < conns_.size (); ++fd)
+      if (conns_[fd] && now - conns_[fd]->lastActive > IDLE_TIMEOUT)
+        closeConnection (conns_[fd].get ());
+  }
+
+  // 读入全部可读数据并处理其中完整的请求；连接被关闭时返回 false
+  bool
+  readRequests (Connection *c, time_t now)
+  {
+    char buf[16384];
+    bool eof = false;
+    while (true)
+      {
+        ssize_t n = read (c->fd, buf, sizeof buf);
+        if (n > 0)
+          {
+            c->in.append (buf, n);
+            continue;
+          }
+        if (n == 0)
+          eof = true;
+        else if (errno == EINTR)
+          continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+          eof = true;
+        break;
+      }
+    c->lastActive = now;
+
+    size_t pos = 0;
+    while (!c->closeAfterSend)
+      {
+        size_t headerEnd = c->in.find ("\r\n\r\n", pos);
+        if (headerEnd == string::npos)
+          {
+            if (c->in.size () - pos > MAX_HEADER_BYTES)
+              {
+                respondError (c, 431, "Request Header Fields Too Large",
+                              false);
+                c->in.clear ();
+                pos = 0;
+              }
+            break;
+          }
+        Request req;
+        if (!parseRequest (c->in.data () + pos, headerEnd - pos, req))
+          {
+            respondError (c, 400, "Bad Request", false);
+            break;
+          }
+        size_t need = headerEnd + 4 + req.bodyBytes;
+        if (!req.bodyTooLarge && c->in.size () < need)
+          break; // 请求体还没收全
+        handle (c, req, now);
+        pos = req.bodyTooLarge ? c->in.size () : need;
+      }
+    c->in.erase (0, pos);
+
+    if (eof && c->out.empty ())
+      {
+        closeConnection (c);
+        return false;
+      }
+    if (eof)
+      c->closeAfterSend = true;
+    return true;
+  }
+
+  bool
+  parseRequest (const char *p, size_t n, Request &req)
+  {
+    const char *end = p + n;
+    const char *lineEnd = (const char *)memchr (p, '\r', n);
+    if (!lineEnd)
+      lineEnd = end;
+    const char *sp1 = (const char *)memchr (p, ' ', lineEnd - p);
+    if (!sp1)
+      return false;
+    const char *sp2 = (const char *)memchr (sp1 + 1, ' ', lineEnd - sp1 - 1);
+    if (!sp2)
+      return false;
+    req.method.assign (p, sp1);
+    req.target.assign (sp1 + 1, sp2);
+    string version (sp2 + 1, lineEnd);
+    req.keepAlive = version == "HTTP/1.1";
+    req.bodyBytes = 0;
+    req.bodyTooLarge = false;
+    req.host.clear ();
+    req.ifNoneMatch.clear ();
+    req.ifModifiedSince.clear ();
+    req.acceptEncoding.clear ();
+
+    const char *line = lineEnd + 2;
+    while (line < end)
+      {
+        const char *eol = (const char *)memchr (line, '\r', end - line);
+        if (!eol)
+          eol = end;
+        const char *colon = (const char *)memchr (line, ':', eol - line);
+        if (colon)
+          {
+            const char *v = colon + 1;
+            while (v < eol && (*v == ' ' || *v == '\t'))
+              ++v;
+            size_t nameLen = colon - line, valueLen = eol - v;
+            if (equalsIgnoreCase (line, nameLen, "Content-Length"))
+              {
+                unsigned long long len = strtoull (string (v, eol).c_str (),
+                                                   NULL, 10);
+                if (len > MAX_BODY_BYTES)
+                  req.bodyTooLarge = true;
+                else
+                  req.bodyBytes = (size_t)len;
+              }
+            else if (equalsIgnoreCase (line, nameLen, "Transfer-Encoding"))
+              req.bodyTooLarge = true; // 不支持分块请求体
+            else if (equalsIgnoreCase (line, nameLen, "Connection"))
+              {
+                if (equalsIgnoreCase (v, valueLen, "close"))
+                  req.keepAlive = false;
+                else if (equalsIgnoreCase (v, valueLen, "keep-alive"))
+                  req.keepAlive = true;
+              }
+            else if (equalsIgnoreCase (line, nameLen, "Host"))
+              req.host.assign (v, eol);
+            else if (equalsIgnoreCase (line, nameLen, "If-None-Match"))
+              req.ifNoneMatch.assign (v, eol);
+            else if (equalsIgnoreCase (line, nameLen, "If-Modified-Since"))
+              req.ifModifiedSince.assign (v, eol);
+            else if (equalsIgnoreCase (line, nameLen, "Accept-Encoding"))
+              req.acceptEncoding.assign (v, eol);
+          }
+        line = eol + 2;
+      }
+    return true;
+  }
+
+  // 把 URL 路径映射到磁盘路径。与 SimpleHTTPRequestHandler 相同，
+  // 丢弃空段、. 和 ..，因此不会越出根目录
+  string
+  translatePath (const string &urlPath) const
+  {
+    static const string STATIC_PREFIX = "/eams/static/";
+    string base = root_;
+    string rest = urlPath;
+    if (!staticDir_.empty ()
+        && rest.compare (0, STATIC_PREFIX.size (), STATIC_PREFIX) == 0)
+      {
+        base = staticDir_;
+        rest = rest.substr (STATIC_PREFIX.size () - 1);
+      }
+    string path = base;
+    size_t i = 0;
+    while (i < rest.size ())
+      {
+        size_t j = rest.find ('/', i);
+        if (j == string::npos)
+          j = rest.size ();
+        string word = rest.substr (i, j - i);
+        if (!word.empty () && word != "." && word != "..")
+          path += "/" + word;
+        i = j + 1;
+      }
+    return path;
+  }
+
+  void
+  handle (Connection *c, const Request &req, time_t now)
+  {
+    bool keepAlive = req.keepAlive && !req.bodyTooLarge;
+    bool head = req.method == "HEAD";
+    // 很多导入 App 用 POST 取数据，与 GET 共用同一套返回逻辑
+    if (req.method != "GET" && req.method != "POST" && !head)
+      {
+        respondError (c, 501, "Unsupported method", keepAlive);
+        return;
+      }
+
+    string target = req.target;
+    size_t q = target.find_first_of ("?#");
+    string query = q == string::npos ? "" : target.substr (q);
+    string urlPath = urlDecode (target.substr (0, q));
+
+    // 订阅入口：重定向到 webcal:// 地址，查询串原样带上
+    if (urlPath == "/subscribe")
+      {
+        string host = req.host.empty () ? "localhost" : req.host;
+        respond (c, 302, "Found", "text/html", Bytes (new string ()),
+                 keepAlive, head,
+                 "Location: webcal://" + host + "/schedule.ics" + query
+                     + "\r\n");
+        return;
+      }
+
+    // 空闲时间查询：/free?ids=学号,学号&weeks=1-16&min=k
+    if (store_ && urlPath == "/free")
+      {
+        string ids, weeks, minText;
+        queryParam (query, "ids", ids);
+        int firstWeek = 1, lastWeek = MAX_WEEKS, minFree = 0;
+        if (queryParam (query, "weeks", weeks)
+            && sscanf (weeks.c_str (), "%d-%d", &firstWeek, &lastWeek) < 1)
+          {
+            respondError (c, 400, "Bad weeks", keepAlive);
+            return;
+          }
+        if (weeks.find ('-') == string::npos)
+          lastWeek = weeks.empty () ? MAX_WEEKS : firstWeek;
+        if (queryParam (query, "min", minText))
+          minFree = atoi (minText.c_str ());
+        string json;
+        if (!store_->freeTime (ids, firstWeek, lastWeek, minFree, json))
+          {
+            respondError (c, 404, "Students not found", keepAlive);
+            return;
+          }
+        respond (c, 200, "OK", "application/json; charset=utf-8",
+                 Bytes (new string (json)), keepAlive, head);
+        return;
+      }
+
+    // 带 ?id= 的请求由课表库即时渲染
+    string id;
+    if (store_ && queryId (query, id))
+      {
+        PageFormat format;
+        const char *type;
+        if (urlPath == "/eams/courseTableForStd.action"
+            || urlPath == "/eams/courseTableForStd!courseTable.action"
+            || urlPath == "/exp_old.html")
+          {
+            format = PAGE_HTML;
+            type = "text/html; charset=utf-8";
+          }
+        else if (urlPath == "/schedule.ics")
+          {
+            format = PAGE_ICS;
+            type = "text/calendar; charset=utf-8";
+          }
+        else if (urlPath == "/courses.csv")
+          {
+            format = PAGE_CSV;
+            type = "text/csv; charset=utf-8";
+          }
+        else
+          {
+            respondError (c, 404, "File not found", keepAlive);
+            return;
+          }
+        RenderedPage page;
+        if (store_->render (id, format, page))
+          respondEntity (c, req, type, page.body, page.etag, page.mtime,
+                         keepAlive, head);
+        else
+          respondError (c, 404, "Student not found", keepAlive);
+        return;
+      }
+
+    string path = translatePath (urlPath);
+
+    // 先查缓存，命中时不再访问磁盘
+    const CachedFile *f = cache_.get (path, now);
+    if (f)
+      {
+        // 有预压缩版本时按 Accept-Encoding 选择，两个版本的 ETag 不同
+        const CachedFile *gz = cache_.variant (path + ".gz", now);
+        if (gz && acceptsGzip (req.acceptEncoding))
+          respondEntity (c, req, f->contentType, gz->body, gz->etag,
+                         gz->mtime, keepAlive, head,
+                         "Content-Encoding: gzip\r\n"
+                         "Vary: Accept-Encoding\r\n");
+        else
+          respondEntity (c, req, f->contentType, f->body, f->etag, f->mtime,
+                         keepAlive, head,
+                         gz ? "Vary: Accept-Encoding\r\n" : "");
+        return;
+      }
+
+    struct stat st;
+    if (stat (path.c_str (), &st) == 0 && S_ISDIR (st.st_mode))
+      {
+        if (!hasSuffix (urlPath, "/"))
+          {
+            string location = target.substr (0, q) + "/" + query;
+            respond (c, 301, "Moved Permanently", "text/html",
+                     Bytes (new string ()), keepAlive, head,
+                     "Location: " + location + "\r\n");
+            return;
+          }
+        const CachedFile *index = cache_.get (path + "/index.html", now);
+        if (!index)
+          index = cache_.get (path + "/index.htm", now);
+        if (index)
+          respondEntity (c, req, index->contentType, index->body,
+                         index->etag, index->mtime, keepAlive, head);
+        else
+          respond (c, 200, "OK", "text/html; charset=utf-8",
+                   listDirectory (path, urlPath), keepAlive, head);
+        return;
+      }
+
+    respondError (c, 404, "File not found", keepAlive);
+  }
+
+  Bytes
+  listDirectory (const string &path, const string &urlPath)
+  {
+    vector<string> names;
+    DIR *d = opendir (path.c_str ());
+    if (d)
+      {
+        while (struct dirent *ent = readdir (d))
+          {
+            string name = ent->d_name;
+            if (name == "." || name == "..")
+              continue;
+            struct stat st;
+            if (stat ((path + "/" + name).c_str (), &st) == 0
+                && S_ISDIR (st.st_mode))
+              name += "/";
+            names.push_back (name);
+          }
+        closedir (d);
+      }
+    sort (names.begin (), names.end ());
+    string title = "Directory listing for " + escapeHtml (urlPath);
+    shared_ptr<string> html (new string ());
+    *html += "<!DOCTYPE HTML>\n<html lang=\"en\">\n<head>\n<meta "
+             "charset=\"utf-8\">\n<title>"
+             + title + "</title>\n</head>\n<body>\n<h1>" + title
+             + "</h1>\n<hr>\n<ul>\n";
+    for (size_t i = 0; i < names.size (); ++i)
+      *html += "<li><a href=\"" + escapeHtml (names[i]) + "\">"
+               + escapeHtml (names[i]) + "</a></li>\n";
+    *html += "</ul>\n<hr>\n</body>\n</html>\n";
+    return html;
+  }
+
+  void
+  respondError (Connection *c, int status, const char *reason, bool keepAlive)
+  {
+    char body[256];
+    snprintf (body, sizeof body,
+              "<html><head><title>Error %d</title></head><body><h1>%d "
+              "%s</h1></body></html>\n",
+              status, status, reason);
+    respond (c, status, reason, "text/html; charset=utf-8",
+             Bytes (new string (body)), keepAlive, false);
+  }
+
+  // HTTP 日期，每秒只格式化一次
+  const string &
+  httpDate ()
+  {
+    time_t now = time (NULL);
+    if (now != dateAt_)
+      {
+        date_ = formatHttpDate (now);
+        dateAt_ = now;
+      }
+    return date_;
+  }
+
+  // 带 ETag 和 Last-Modified 返回内容。GET/HEAD 的条件请求命中时只回
+  // 304；有 If-None-Match 时忽略 If-Modified-Since
+  void
+  respondEntity (Connection *c, const Request &req, const string &contentType,
+                 const Bytes &body, const string &etag, time_t mtime,
+                 bool keepAlive, bool head,
+                 const string &extraHeaders = string ())
+  {
+    string validators = extraHeaders + "ETag: " + etag + "\r\nLast-Modified: "
+                        + formatHttpDate (mtime) + "\r\n";
+    // 课表和日历要求客户端每次都验证，静态资源交给浏览器自行缓存
+    if (contentType.compare (0, 9, "text/html") == 0
+        || contentType.compare (0, 13, "text/calendar") == 0
+        || contentType.compare (0, 8, "text/csv") == 0)
+      validators += "Cache-Control: no-cache\r\n";
+
+    bool notModified = false;
+    if (req.method != "POST")
+      {
+        if (!req.ifNoneMatch.empty ())
+          notModified = etagMatches (req.ifNoneMatch, etag);
+        else if (!req.ifModifiedSince.empty ())
+          {
+            time_t since = parseHttpDate (req.ifModifiedSince);
+            notModified = since != -1 && mtime <= since;
+          }
+      }
+    if (notModified)
+      respond (c, 304, "Not Modified", contentType, Bytes (new string ()),
+               keepAlive, true, validators);
+    else
+      respond (c, 200, "OK", contentType, body, keepAlive, head, validators);
+  }
+
+  void
+  respond (Connection *c, int status, const char *reason,
+           const string &contentType, const Bytes &body, bool keepAlive,
+           bool head, const string &extraHeaders = string ())
+  {
+    char line[128];
+    snprintf (line, sizeof line, "HTTP/1.1 %d %s\r\n", status, reason);
+    shared_ptr<string> header (new string (line));
+    *header += "Server: NeuCourseServer\r\nDate: " + httpDate () + "\r\n";
+    // 304 不带实体头，客户端沿用已缓存的内容
+    if (status != 304)
+      {
+        *header += "Content-Type: " + contentType + "\r\n";
+        snprintf (line, sizeof line, "Content-Length: %zu\r\n",
+                  body->size ());
+        *header += line;
+      }
+    *header += "Access-Control-Allow-Origin: *\r\n";
+    *header += extraHeaders;
+    *header += keepAlive ? "Connection: keep-alive\r\n\r\n"
+                         : "Connection: close\r\n\r\n";
+    Chunk h = { header, 0 };
+    c->out.push_back (h);
+    if (!head && !body->empty ())
+      {
+        Chunk b = { body, 0 };
+        c->out.push_back (b);
+      }
+    if (!keepAlive)
+      c->closeAfterSend = true;
+  }
+
+  // 尽量把待发送数据写出；写不完就注册 EPOLLOUT，等可写时继续。
+  // 有进展就算活跃，慢速客户端收大文件时不会被当作空闲连接断开
+  void
+  flush (Connection *c, time_t now)
+  {
+    while (!c->out.empty ())
+      {
+        iovec iov[64];
+        int cnt = 0;
+        for (deque<Chunk>::iterator it = c->out.begin ();
+             it != c->out.end () && cnt < 64; ++it, ++cnt)
+          {
+            iov[cnt].iov_base = (void *)(it->data->data () + it->offset);
+            iov[cnt].iov_len = it->data->size () - it->offset;
+          }
+        ssize_t n = writev (c->fd, iov, cnt);
+        if (n < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+              break;
+            closeConnection (c);
+            return;
+          }
+        if (n > 0)
+          c->lastActive = now;
+        size_t left = (size_t)n;
+        while (left > 0)
+          {
+            Chunk &front = c->out.front ();
+            size_t avail = front.data->size () - front.offset;
+            if (left < avail)
+              {
+                front.offset += left;
+                break;
+              }
+            left -= avail;
+            c->out.pop_front ();
+          }
+      }
+
+    if (c->out.empty () && c->closeAfterSend)
+      {
+        closeConnection (c);
+        return;
+      }
+    bool wantWrite = !c->out.empty ();
+    if (wantWrite != c->writeArmed)
+      {
+        epoll_event ev;
+        memset (&ev, 0, sizeof ev);
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        if (wantWrite)
+          ev.events |= EPOLLOUT;
+        ev.data.fd = c->fd;
+        epoll_ctl (epfd_, EPOLL_CTL_MOD, c->fd, &ev);
+        c->writeArmed = wantWrite;
+      }
+  }
+
+  string root_;
+  string staticDir_;
+  ScheduleStore *store_; // 未指定 --store 时为空
+  int epfd_;
+  int listenFd_;
+  int spareFd_;       // 预留的描述符，用尽时腾出来拒绝连接
+  bool listenPaused_; // 连预留的描述符也没有，暂时不监听
+  bool fdsExhausted_; // 已报告过描述符用尽，恢复前不再重复输出
+  vector<unique_ptr<Connection> > conns_; // 以 fd 为下标
+  FileCache cache_;
+  string date_;
+  time_t dateAt_;
+};
+
+void
+printUsage ()
+{
+  cerr << "用法: web_server [--port N] [--root 目录] [--static 目录]\n"
+          "                  [--store 目录|清单] [--date YYYY-MM-DD] "
+          "[--page-cache-mb N]\n"
+          "  --port           监听端口，默认 8080\n"
+          "  --root           网站根目录，默认为当前目录\n"
+          "  --static         把 /eams/static/ 映射到该目录（如 "
+          "resources/static）\n"
+          "  --store          载入多个学生的课表，按 ?id=学号 提供页面\n"
+          "  --date           课表库生成 ICS 用的学期第一周周日，默认 "
+          "2026-03-01\n"
+          "  --page-cache-mb  渲染结果缓存的上限，默认 64"
+       << endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int port = 8080;
+  string root = ".";
+  string staticDir;
+  string storeSource;
+  string startSunday = "2026-03-01";
+  size_t pageCacheMb = 64;
+  for (int i = 1; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--port" && i + 1 < argc)
+        port = atoi (argv[++i]);
+      else if (arg == "--root" && i + 1 < argc)
+        root = argv[++i];
+      else if (arg == "--static" && i + 1 < argc)
+        staticDir = argv[++i];
+      else if (arg == "--store" && i + 1 < argc)
+        storeSource = argv[++i];
+      else if (arg == "--date" && i + 1 < argc)
+        startSunday = argv[++i];
+      else if (arg == "--page-cache-mb" && i + 1 < argc)
+        pageCacheMb = (size_t)atol (argv[++i]);
+      else
+        {
+          printUsage ();
+          return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+  // 尽量提高文件描述符上限，以容纳数千个并发连接
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit (RLIMIT_NOFILE, &rl);
+    }
+  signal (SIGPIPE, SIG_IGN);
+  signal (SIGINT, onSignal);
+  signal (SIGTERM, onSignal);
+
+  unique_ptr<ScheduleStore> store;
+  if (!storeSource.empty ())
+    {
+      store.reset (new ScheduleStore (startSunday, pageCacheMb << 20));
+      time_t t0 = time (NULL);
+      string err;
+      if (!store->load (storeSource, thread::hardware_concurrency (), err))
+        {
+          cerr << err << endl;
+          return 1;
+        }
+      cout << "已载入 " << store->size () << " 名学生的课表，耗时 "
+           << time (NULL) - t0 << " s，峰值内存 " << peakRssKb () / 1024
+           << " MB" << endl;
+    }
+
+  Server server (root, staticDir, store.get ());
+  cout << "NEU Server starting on port " << port << "..." << endl;
+  if (!server.listenOn (port))
+    {
+      perror ("无法监听端口");
+      return 1;
+    }
+  server.preload ();
+  cout << "Serving at: http://0.0.0.0:" << port << endl;
+  server.run ();
+  if (store)
+    store->report ();
+  cout << "峰值内存 " << peakRssKb () / 1024 << " MB" << endl;
+  return 0;
+}
@@ -0,0 +1,407 @@
+/**
+ * @file web_server_loadtest.cpp
+ * @author PopulusYang
+ * @brief 课表共享服务器的本地压测工具
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+// 用单线程 epoll 同时维持大量 keep-alive 连接，每个连接收到完整响应后
+// 立即发出下一个请求，模拟一整层宿舍同时导入课表。服务器若关闭连接
+// （如 web_server.py 按 HTTP/1.0 应答），则重新连接后继续。结束时输出
+// 吞吐和延迟分位数。路径中的 {id} 在每次请求时替换为随机学号，用于
+// 压测 --store 模式下的多学生课表库。--revalidate 让客户端像日历订阅一样
+// 带上次收到的 ETag 发条件请求，304 计为成功。
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+struct Client
+{
+  int fd;
+  string in;            // 当前响应已收到的数据
+  string request;       // 当前请求
+  string path;          // 当前请求的路径
+  size_t sent;          // 当前请求已发送的字节数
+  Clock::time_point t0; // 当前请求的发出时间，新连接从发起连接时算起
+};
+
+class LoadTest
+{
+public:
+  LoadTest (const sockaddr_in &addr, const string &host, const string &path,
+            bool post, unsigned long long idBase, unsigned long long ids,
+            bool revalidate)
+      : addr_ (addr), host_ (host), path_ (path), post_ (post),
+        idBase_ (idBase), ids_ (ids), revalidate_ (revalidate), rng_ (12345),
+        epfd_ (-1), completed_ (0), notModified_ (0), errors_ (0),
+        reconnects_ (0), bytes_ (0)
+  {
+    idPos_ = path_.find ("{id}");
+  }
+
+  bool
+  run (int connections, double seconds)
+  {
+    epfd_ = epoll_create1 (EPOLL_CLOEXEC);
+    if (epfd_ < 0)
+      return false;
+    clients_.resize (connections);
+    for (int i = 0; i < connections; ++i)
+      {
+        clients_[i].fd = -1;
+        if (!connectClient (i))
+          {
+            cerr << "第 " << i << " 个连接建立失败: " << strerror (errno)
+                 << endl;
+            return false;
+          }
+      }
+
+    vector<epoll_event> events (1024);
+    Clock::time_point start = Clock::now ();
+    Clock::time_point deadline
+        = start + chrono::microseconds ((long long)(seconds * 1e6));
+    while (Clock::now () < deadline)
+      {
+        int n = epoll_wait (epfd_, &events[0], (int)events.size (), 100);
+        for (int i = 0; i < n; ++i)
+          {
+            size_t idx = events[i].data.u64;
+            if (events[i].events & EPOLLOUT)
+              sendRequest (idx);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+              readResponse (idx);
+          }
+      }
+    elapsed_ = chrono::duration<double> (Clock::now () - start).count ();
+    for (size_t i = 0; i < clients_.size (); ++i)
+      if (clients_[i].fd >= 0)
+        close (clients_[i].fd);
+    return true;
+  }
+
+  void
+  report (int connections) const
+  {
+    vector<double> lat (latencies_);
+    sort (lat.begin (), lat.end ());
+    cout << fixed << setprecision (2);
+    cout << "并发连接 " << connections << "，耗时 " << elapsed_ << " s"
+         << endl;
+    cout << "完成请求 " << completed_ << "（其中 304 " << notModified_
+         << "），错误 " << errors_ << "，重连 " << reconnects_ << endl;
+    cout << "吞吐 " << completed_ / elapsed_ << " req/s，"
+         << bytes_ / elapsed_ / (1024.0 * 1024.0) << " MB/s" << endl;
+    if (!lat.empty ())
+      cout << "延迟 p50 " << percentile (lat, 0.50) << " ms，p90 "
+           << percentile (lat, 0.90) << " ms，p99 " << percentile (lat, 0.99)
+           << " ms，最大 " << lat.back () << " ms" << endl;
+  }
+
+private:
+  static double
+  percentile (const vector<double> &sorted, double p)
+  {
+    size_t i = (size_t)(p * (sorted.size () - 1));
+    return sorted[i];
+  }
+
+  // 准备下一个请求，路径含 {id} 时换上随机学号
+  void
+  nextRequest (Client &c)
+  {
+    c.sent = 0;
+    c.t0 = Clock::now ();
+    c.path = path_;
+    if (idPos_ != string::npos)
+      {
+        rng_ = rng_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        char id[24];
+        snprintf (id, sizeof id, "%llu", idBase_ + 1 + (rng_ >> 33) % ids_);
+        c.path.replace (idPos_, 4, id);
+      }
+    c.request = (post_ ? "POST " : "GET ") + c.path + " HTTP/1.1\r\nHost: "
+                + host_ + "\r\n";
+    if (revalidate_)
+      {
+        map<string, string>::const_iterator it = etags_.find (c.path);
+        if (it != etags_.end ())
+          c.request += "If-None-Match: " + it->second + "\r\n";
+      }
+    if (post_)
+      c.request += "Content-Type: application/x-www-form-urlencoded\r\n"
+                   "Content-Length: 18\r\n\r\nsemester.id=30&x=1";
+    else
+      c.request += "\r\n";
+  }
+
+  bool
+  connectClient (size_t idx)
+  {
+    Client &c = clients_[idx];
+    c.fd = socket (AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c.fd < 0)
+      return false;
+    int one = 1;
+    setsockopt (c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    if (connect (c.fd, (const sockaddr *)&addr_, sizeof addr_) != 0
+        && errno != EINPROGRESS)
+      {
+        close (c.fd);
+        c.fd = -1;
+        return false;
+      }
+    c.in.clear ();
+    nextRequest (c);
+    epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.u64 = idx;
+    return epoll_ctl (epfd_, EPOLL_CTL_ADD, c.fd, &ev) == 0;
+  }
+
+  void
+  reconnect (size_t idx)
+  {
+    Client &c = clients_[idx];
+    if (c.fd >= 0)
+      close (c.fd);
+    c.fd = -1;
+    ++reconnects_;
+    if (!connectClient (idx))
+      ++errors_;
+  }
+
+  void
+  setWritable (size_t idx, bool wantWrite)
+  {
+    epoll_event ev;
+    memset (&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    if (wantWrite)
+      ev.events |= EPOLLOUT;
+    ev.data.u64 = idx;
+    epoll_ctl (epfd_, EPOLL_CTL_MOD, clients_[idx].fd, &ev);
+  }
+
+  void
+  sendRequest (size_t idx)
+  {
+    Client &c = clients_[idx];
+    if (c.fd < 0 || c.sent == c.request.size ())
+      return;
+    ssize_t n = send (c.fd, c.request.data () + c.sent,
+                      c.request.size () - c.sent, MSG_NOSIGNAL);
+    if (n < 0)
+      {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          {
+            ++errors_;
+            reconnect (idx);
+          }
+        return;
+      }
+    c.sent += n;
+    setWritable (idx, c.sent < c.request.size ());
+  }
+
+  // 读取响应；收全一个响应后记录延迟并发出下一个请求
+  void
+  readResponse (size_t idx)
+  {
+    Client &c = clients_[idx];
+    if (c.fd < 0)
+      return;
+    char buf[65536];
+    bool eof = false;
+    while (true)
+      {
+        ssize_t n = recv (c.fd, buf, sizeof buf, 0);
+        if (n > 0)
+          {
+            c.in.append (buf, n);
+            continue;
+          }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+          eof = true;
+        break;
+      }
+
+    size_t headerEnd = c.in.find ("\r\n\r\n");
+    if (headerEnd != string::npos)
+      {
+        string header = c.in.substr (0, headerEnd);
+        size_t length = 0;
+        size_t pos = header.find ("Content-Length:");
+        if (pos == string::npos)
+          pos = header.find ("content-length:");
+        if (pos != string::npos)
+          length = strtoul (header.c_str () + pos + 15, NULL, 10);
+        bool closing = header.find ("Connection: close") != string::npos
+                       || header.compare (0, 8, "HTTP/1.0") == 0;
+        if (c.in.size () >= headerEnd + 4 + length)
+          {
+            double ms = chrono::duration<double, milli> (Clock::now () - c.t0)
+                            .count ();
+            latencies_.push_back (ms);
+            ++completed_;
+            bytes_ += headerEnd + 4 + length;
+            if (header.size () >= 12 && header.compare (9, 3, "304") == 0)
+              ++notModified_;
+            else if (header.size () < 12 || header.compare (9, 3, "200") != 0)
+              ++errors_;
+            if (revalidate_)
+              {
+                size_t e = header.find ("\r\nETag: ");
+                if (e != string::npos)
+                  {
+                    size_t eol = header.find ('\r', e + 8);
+                    etags_[c.path] = header.substr (e + 8, eol - e - 8);
+                  }
+              }
+            if (closing)
+              {
+                reconnect (idx);
+                return;
+              }
+            c.in.erase (0, headerEnd + 4 + length);
+            nextRequest (c);
+            sendRequest (idx);
+            return;
+          }
+      }
+    if (eof)
+      {
+        ++errors_;
+        reconnect (idx);
+      }
+  }
+
+  sockaddr_in addr_;
+  string host_;
+  string path_;
+  bool post_;
+  size_t idPos_; // path_ 中 {id} 的位置
+  unsigned long long idBase_;
+  unsigned long long ids_;
+  bool revalidate_;
+  map<string, string> etags_; // 各路径最近一次收到的 ETag
+  unsigned long long rng_;
+  int epfd_;
+  vector<Client> clients_;
+  vector<double> latencies_;
+  unsigned long long completed_;
+  unsigned long long notModified_;
+  unsigned long long errors_;
+  unsigned long long reconnects_;
+  unsigned long long bytes_;
+  double elapsed_;
+};
+
+void
+printUsage ()
+{
+  cerr << "用法: web_server_loadtest [--host IP] [--port N] [--path 路径]\n"
+          "                          [--connections N] [--seconds S] "
+          "[--post]\n"
+          "                          [--id-base N] [--ids N] "
+          "[--revalidate]\n"
+          "  默认向 127.0.0.1:8080 的 /eams/courseTableForStd.action\n"
+          "  以 1000 个连接持续请求 10 秒。路径中的 {id} 替换为\n"
+          "  id-base+1 到 id-base+ids 之间的随机学号。--revalidate\n"
+          "  时带上次的 ETag 发条件请求"
+       << endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  string host = "127.0.0.1";
+  int port = 8080;
+  string path = "/eams/courseTableForStd.action";
+  int connections = 1000;
+  double seconds = 10;
+  bool post = false;
+  bool revalidate = false;
+  unsigned long long idBase = 20240000;
+  unsigned long long ids = 10000;
+  for (int i = 1; i < argc; ++i)
+    {
+      string arg = argv[i];
+      if (arg == "--host" && i + 1 < argc)
+        host = argv[++i];
+      else if (arg == "--port" && i + 1 < argc)
+        port = atoi (argv[++i]);
+      else if (arg == "--path" && i + 1 < argc)
+        path = argv[++i];
+      else if (arg == "--connections" && i + 1 < argc)
+        connections = atoi (argv[++i]);
+      else if (arg == "--seconds" && i + 1 < argc)
+        seconds = atof (argv[++i]);
+      else if (arg == "--post")
+        post = true;
+      else if (arg == "--revalidate")
+        revalidate = true;
+      else if (arg == "--id-base" && i + 1 < argc)
+        idBase = strtoull (argv[++i], NULL, 10);
+      else if (arg == "--ids" && i + 1 < argc)
+        ids = strtoull (argv[++i], NULL, 10);
+      else
+        {
+          printUsage ();
+          return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+  if (connections <= 0 || seconds <= 0 || ids == 0)
+    {
+      printUsage ();
+      return 1;
+    }
+
+  sockaddr_in addr;
+  memset (&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons ((uint16_t)port);
+  if (inet_pton (AF_INET, host.c_str (), &addr.sin_addr) != 1)
+    {
+      cerr << "无效的地址 " << host << endl;
+      return 1;
+    }
+
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit (RLIMIT_NOFILE, &rl);
+    }
+  signal (SIGPIPE, SIG_IGN);
+
+  LoadTest test (addr, host, path, post, idBase, ids, revalidate);
+  if (!test.run (connections, seconds))
+    return 1;
+  test.report (connections);
+  return 0;
+}
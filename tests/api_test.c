@@ -0,0 +1,243 @@
+/**
+ * @file api_test.c
+ * @author PopulusYang
+ * @brief NeuCourseApi.h 中 C 接口的单元测试，链接动态库 neucourse
+ * @license MIT
+ * @date 2026-01-12
+ */
+
+/* 用法: api_test <页面> <期望的 courses.csv> <可写的临时目录>
+   用纯 C 编写，同时检查头文件能被 C 编译器使用。 */
+
+#include "NeuCourseApi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                           \
+  do                                                                          \
+    {                                                                         \
+      if (!(cond))                                                            \
+        {                                                                     \
+          fprintf (stderr, "%s:%d: 检查失败: %s\n", __FILE__, __LINE__,      \
+                   #cond);                                                    \
+          ++failures;                                                         \
+        }                                                                     \
+    }                                                                         \
+  while (0)
+
+/* 整个文件读入内存，失败时返回 NULL */
+static char *
+readFile (const char *path, size_t *size)
+{
+  FILE *f = fopen (path, "rb");
+  char *data;
+  long n;
+  if (!f)
+    return NULL;
+  fseek (f, 0, SEEK_END);
+  n = ftell (f);
+  fseek (f, 0, SEEK_SET);
+  data = (char *)malloc ((size_t)n + 1);
+  if (data && fread (data, 1, (size_t)n, f) != (size_t)n)
+    {
+      free (data);
+      data = NULL;
+    }
+  fclose (f);
+  if (data)
+    {
+      data[n] = '\0';
+      *size = (size_t)n;
+    }
+  return data;
+}
+
+static int
+fileExists (const char *dir, const char *name)
+{
+  char path[1024];
+  FILE *f;
+  snprintf (path, sizeof path, "%s/%s", dir, name);
+  f = fopen (path, "rb");
+  if (f)
+    fclose (f);
+  return f != NULL;
+}
+
+/* nct_write_ics/csv/html 的统一形式 */
+typedef int (*Writer) (nct_schedule *, char *, size_t, size_t *);
+
+static int
+writeIcsPlain (nct_schedule *s, char *buf, size_t cap, size_t *len)
+{
+  return nct_write_ics (s, "2026-03-01", 0, buf, cap, len);
+}
+
+static int
+writeIcsExpanded (nct_schedule *s, char *buf, size_t cap, size_t *len)
+{
+  return nct_write_ics (s, "2026-03-01", NCT_EXPAND_ICS, buf, cap, len);
+}
+
+/* 缓冲区为空、小一个字节、恰好够用三种情况，返回取得的输出 */
+static char *
+checkWriter (nct_schedule *s, Writer write, size_t *size)
+{
+  size_t len = 0, again = 0;
+  char *buf;
+  CHECK (write (s, NULL, 0, &len) == NCT_E_BUFFER);
+  CHECK (len > 0);
+  buf = (char *)malloc (len + 1);
+  memset (buf, '#', len + 1);
+  CHECK (write (s, buf, len - 1, &again) == NCT_E_BUFFER);
+  CHECK (again == len);
+  CHECK (buf[0] == '#'); /* 不够时不写 buf */
+  CHECK (write (s, buf, len, &again) == NCT_OK);
+  CHECK (again == len);
+  CHECK (buf[len] == '#'); /* 不写结尾的 '\0' */
+  buf[len] = '\0';
+  *size = len;
+  return buf;
+}
+
+static void
+testParse (const char *html, size_t size, const char *csv)
+{
+  const char *junk = "<html>不是课表</html>";
+  nct_schedule *s;
+  nct_course c;
+  size_t i, n, len;
+  char *out;
+
+  /* 无效与空输入 */
+  CHECK (nct_parse (NULL, 10) == NULL);
+  s = nct_parse (NULL, 0);
+  CHECK (s != NULL);
+  CHECK (nct_course_count (s) == 0);
+  nct_free (s);
+  s = nct_parse (junk, strlen (junk));
+  CHECK (s != NULL);
+  CHECK (nct_course_count (s) == 0);
+  CHECK (nct_get_course (s, 0, &c) == NCT_E_INVALID);
+  nct_free (s);
+  nct_free (NULL);
+  CHECK (nct_course_count (NULL) == 0);
+  CHECK (nct_semester_info (NULL) == NULL);
+
+  s = nct_parse (html, size);
+  CHECK (s != NULL);
+  if (!s)
+    return;
+  n = nct_course_count (s);
+  CHECK (n > 0);
+  CHECK (nct_semester_info (s) != NULL);
+  for (i = 0; i < n; ++i)
+    {
+      CHECK (nct_get_course (s, i, &c) == NCT_OK);
+      CHECK (c.title && *c.title && c.location && c.description && c.weeks);
+      CHECK (c.day >= 0 && c.day <= 6);
+      CHECK (c.start_period >= 1 && c.start_period <= c.end_period);
+      CHECK (c.week_mask != 0);
+    }
+  CHECK (nct_get_course (s, n, &c) == NCT_E_INVALID);
+  CHECK (nct_get_course (s, (size_t)-1, &c) == NCT_E_INVALID);
+  CHECK (nct_get_course (s, 0, NULL) == NCT_E_INVALID);
+  CHECK (nct_get_course (NULL, 0, &c) == NCT_E_INVALID);
+
+  out = checkWriter (s, writeIcsPlain, &len);
+  CHECK (strncmp (out, "BEGIN:VCALENDAR", 15) == 0);
+  CHECK (strstr (out, "RRULE:") != NULL);
+  free (out);
+  out = checkWriter (s, writeIcsExpanded, &len);
+  CHECK (strstr (out, "RRULE:") == NULL);
+  free (out);
+  out = checkWriter (s, nct_write_csv, &len);
+  CHECK (strcmp (out, csv) == 0); /* 与命令行程序的 courses.csv 相同 */
+  free (out);
+  out = checkWriter (s, nct_write_html, &len);
+  CHECK (strstr (out, "<html") != NULL);
+  free (out);
+
+  CHECK (nct_write_ics (s, "不是日期", 0, NULL, 0, &len) == NCT_E_INVALID);
+  CHECK (nct_write_ics (s, NULL, 0, NULL, 0, &len) == NCT_E_INVALID);
+  CHECK (nct_write_ics (NULL, "2026-03-01", 0, NULL, 0, &len)
+         == NCT_E_INVALID);
+  CHECK (nct_write_csv (NULL, NULL, 0, &len) == NCT_E_INVALID);
+  CHECK (nct_write_html (NULL, NULL, 0, &len) == NCT_E_INVALID);
+  nct_free (s);
+}
+
+static void
+testConvert (const char *page, const char *html, size_t size,
+             const char *tmp)
+{
+  char dir[1024], err[512];
+  size_t courses = 0, expected;
+  nct_schedule *s = nct_parse (html, size);
+  expected = nct_course_count (s);
+  nct_free (s);
+
+  snprintf (dir, sizeof dir, "%s/convert", tmp);
+  CHECK (nct_convert_file (page, dir, "2026-03-01", NCT_DELTA_ICS, &courses,
+                           err, sizeof err)
+         == NCT_OK);
+  CHECK (err[0] == '\0');
+  CHECK (courses == expected);
+  CHECK (fileExists (dir, "schedule.ics"));
+  CHECK (fileExists (dir, "schedule-delta.ics"));
+  CHECK (fileExists (dir, "courses.csv"));
+  CHECK (fileExists (dir, "exp_old.html"));
+  CHECK (fileExists (dir, "eams/courseTableForStd.action"));
+  CHECK (fileExists (dir, "eams/courseTableForStd!courseTable.action"));
+  CHECK (fileExists (dir, "schedule.cache"));
+
+  /* 不使用缓存时不写 schedule.cache */
+  snprintf (dir, sizeof dir, "%s/convert-nocache", tmp);
+  CHECK (nct_convert_file (page, dir, "2026-03-01", NCT_NO_CACHE, NULL, NULL,
+                           0)
+         == NCT_OK);
+  CHECK (fileExists (dir, "schedule.ics"));
+  CHECK (!fileExists (dir, "schedule.cache"));
+
+  CHECK (nct_convert_file (page, dir, "bogus", 0, NULL, err, sizeof err)
+         == NCT_E_INVALID);
+  CHECK (err[0] != '\0');
+  CHECK (nct_convert_file ("/nonexistent/exp.html", dir, "2026-03-01", 0,
+                           NULL, err, sizeof err)
+         == NCT_E_IO);
+  CHECK (err[0] != '\0');
+  CHECK (nct_convert_file (NULL, dir, "2026-03-01", 0, NULL, err, 4)
+         == NCT_E_INVALID);
+  CHECK (strlen (err) < 4); /* 错误信息按 err_cap 截断 */
+}
+
+int
+main (int argc, char *argv[])
+{
+  size_t size = 0, csvSize = 0;
+  char *html, *csv;
+  if (argc != 4)
+    {
+      fprintf (stderr, "用法: api_test <页面> <courses.csv> <临时目录>\n");
+      return 2;
+    }
+  html = readFile (argv[1], &size);
+  csv = readFile (argv[2], &csvSize);
+  if (!html || !csv)
+    {
+      fprintf (stderr, "无法读取 %s 或 %s\n", argv[1], argv[2]);
+      return 2;
+    }
+  CHECK (nct_version () != NULL);
+  testParse (html, size, csv);
+  testConvert (argv[1], html, size, argv[3]);
+  free (html);
+  free (csv);
+  if (failures)
+    fprintf (stderr, "%d 项检查失败\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+# 批量模式的参数检查：无效的开学日期和 --jobs 必须在写任何输出之前以
+# 非零状态退出；合法但远大于任务数的 --jobs 仍能正常转换。
+#
+#   cmake -DBIN=... -DPAGE=... -DWORK=... -P batch_args.cmake
+
+foreach(var BIN PAGE WORK)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "缺少 -D${var}=...")
+    endif()
+endforeach()
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}/in")
+configure_file("${PAGE}" "${WORK}/in/student.html" COPYONLY)
+
+# 期望失败，且 stderr 含有 message、输出目录没有被创建
+function(expect_reject message)
+    execute_process(COMMAND "${BIN}" --batch "${WORK}/in" "${WORK}/out" ${ARGN}
+        RESULT_VARIABLE rc
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE err)
+    if(NOT rc EQUAL 1)
+        message(SEND_ERROR "${ARGN}: 期望返回 1，实际为 ${rc}\n${err}")
+    elseif(NOT err MATCHES "${message}")
+        message(SEND_ERROR "${ARGN}: 错误信息不含「${message}」:\n${err}")
+    endif()
+    if(EXISTS "${WORK}/out")
+        message(SEND_ERROR "${ARGN}: 参数无效时仍创建了输出目录")
+        file(REMOVE_RECURSE "${WORK}/out")
+    endif()
+endfunction()
+
+expect_reject("无法解析日期" bogus)
+expect_reject("无法解析日期" 10000-01-01)
+expect_reject("无法解析线程数" 2026-03-01 --jobs -1)
+expect_reject("无法解析线程数" 2026-03-01 --jobs 0)
+expect_reject("无法解析线程数" 2026-03-01 --jobs 4x)
+expect_reject("无法解析线程数" 2026-03-01 --jobs 99999999999)
+
+# 线程数多于任务数时只按任务数启动线程
+execute_process(COMMAND "${BIN}" --batch "${WORK}/in" "${WORK}/out"
+        2026-03-01 --jobs 1000
+    RESULT_VARIABLE rc
+    OUTPUT_VARIABLE out
+    ERROR_VARIABLE err)
+if(NOT rc EQUAL 0 OR NOT EXISTS "${WORK}/out/student/schedule.ics")
+    message(SEND_ERROR "--jobs 1000: 返回 ${rc}，未生成 schedule.ics\n${err}")
+endif()
@@ -0,0 +1,52 @@
+# 黄金输出测试：把 PAGE 当作 exp.html 交给 NeuCourseTabel（BIN），先按默认
+# 格式、再加 --expand-ics 各转换一次，逐字节比对 EXPECTED 目录下的
+# schedule.ics、schedule-expanded.ics、courses.csv、exp_old.html 以及
+# eams/ 下的两个页面（与 exp_old.html 相同）。
+#
+#   cmake -DBIN=... -DPAGE=... -DEXPECTED=... -DWORK=... -P golden.cmake
+#
+# 期望输出与最初基于正则表达式的解析器一致（ICS 的 UID、DTSTAMP、
+# SEQUENCE 及重复规则是之后加上的）。DTSTAMP 取自 SOURCE_DATE_EPOCH。
+
+foreach(var BIN PAGE EXPECTED WORK)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "缺少 -D${var}=...")
+    endif()
+endforeach()
+
+set(ENV{SOURCE_DATE_EPOCH} 1)
+
+# 在 dir 中转换一次，args 为附加的命令行参数
+function(convert dir)
+    file(REMOVE_RECURSE "${dir}")
+    file(MAKE_DIRECTORY "${dir}")
+    configure_file("${PAGE}" "${dir}/exp.html" COPYONLY)
+    execute_process(COMMAND "${BIN}" --no-cache ${ARGN} 2026-03-01
+        WORKING_DIRECTORY "${dir}"
+        RESULT_VARIABLE rc
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE out)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "NeuCourseTabel 在 ${dir} 中返回 ${rc}:\n${out}")
+    endif()
+endfunction()
+
+function(expect actual expected)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+        "${actual}" "${expected}" RESULT_VARIABLE rc)
+    if(NOT rc EQUAL 0)
+        message(SEND_ERROR "输出不同: ${actual}\n      期望: ${expected}")
+    endif()
+endfunction()
+
+convert("${WORK}/default")
+expect("${WORK}/default/schedule.ics" "${EXPECTED}/schedule.ics")
+expect("${WORK}/default/courses.csv" "${EXPECTED}/courses.csv")
+expect("${WORK}/default/exp_old.html" "${EXPECTED}/exp_old.html")
+expect("${WORK}/default/eams/courseTableForStd.action"
+       "${EXPECTED}/exp_old.html")
+expect("${WORK}/default/eams/courseTableForStd!courseTable.action"
+       "${EXPECTED}/exp_old.html")
+
+convert("${WORK}/expanded" --expand-ics)
+expect("${WORK}/expanded/schedule.ics" "${EXPECTED}/schedule-expanded.ics")